@@ -1,4 +1,4 @@
-// g++ -o fractals main.cpp -lncurses `pkg-config --cflags --libs opencv4`
+// g++ -O2 -pthread -o fractals main.cpp -lncurses -lgmpxx -lgmp -lpng `pkg-config --cflags --libs opencv4`
 
 #include <ncurses.h>
 #include <cmath>
@@ -7,6 +7,30 @@
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdio>
+#include <cerrno>
+#include <map>
+#include <utility>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <gmpxx.h>
+#include <png.h>
+#include <zlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FRACTALS_X86_SIMD
+#endif
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
 #include <opencv2/imgcodecs.hpp>
@@ -44,23 +68,1130 @@ struct RGBColor {
 		r(red), g(green), b(blue) {}
 };
 
+// Subpixel samples of the pixels an export refines
+enum SamplePattern {
+	SAMPLES_OFF,
+	SAMPLES_GRID_2,		// 2x2 regular grid
+	SAMPLES_GRID_3,
+	SAMPLES_GRID_4,
+	SAMPLES_ROTATED_4,	// 4 samples on a rotated grid, no two sharing a row or column
+	SAMPLE_PATTERN_COUNT
+};
+
+// Offsets of the samples from the pixel center, in pixels
+inline vector<pair<double, double>> sampleOffsets(SamplePattern pattern) {
+	vector<pair<double, double>> offsets;
+	switch (pattern) {
+		case SAMPLES_GRID_2: case SAMPLES_GRID_3: case SAMPLES_GRID_4: {
+			int side = pattern - SAMPLES_GRID_2 + 2;
+			for (int i = 0; i < side; ++i)
+				for (int j = 0; j < side; ++j)
+					offsets.push_back({(j + 0.5) / side - 0.5, (i + 0.5) / side - 0.5});
+			break;
+		}
+		case SAMPLES_ROTATED_4:
+			offsets = {{-0.125, -0.375}, {0.375, -0.125}, {0.125, 0.375}, {-0.375, 0.125}};
+			break;
+		default: break;
+	}
+	return offsets;
+}
+
+// Colors and terminal symbols of every iteration count 0..maxiter for one palette
+struct PaletteLut {
+	ColorPalette palette;
+	int maxiter;
+	double gamma;
+	vector<cv::Vec3b> colors;	// BGR, as the exports store it
+	vector<char> chars;
+
+	PaletteLut() : palette(PALETTE_COUNT), maxiter(-1), gamma(0.) {}
+	bool matches(ColorPalette p, int iterations, double g) const { return palette == p && maxiter == iterations && gamma == g; }
+};
+
 struct FractalSettings {
 	double centerX, centerY;	// Center of the FOV
 	double scale;				// Horisontal size of one symbol
 	double juliaCx, juliaCy;	// Fixed point for Julia
+	mpf_class preciseX, preciseY;	// Center of the FOV in full precision, centerX and centerY are its rounded copies
     
-	FractalSettings() : centerX(0), centerY(0), scale(0.01), juliaCx(-0.7), juliaCy(0.27) {}
+	FractalSettings() : centerX(0), centerY(0), scale(0.01), juliaCx(-0.7), juliaCy(0.27), preciseX(0), preciseY(0) {}
+
+	void setCenter(double x, double y) {
+		preciseX = x; preciseY = y;
+		centerX = x; centerY = y;
+	}
+
+	void moveCenter(double dx, double dy) {
+		updatePrecision();
+		preciseX += dx; preciseY += dy;
+		centerX = preciseX.get_d(); centerY = preciseY.get_d();
+	}
+
+	// Keeps enough bits to tell neighbouring symbols apart at the current scale
+	void updatePrecision() {
+		mp_bitcnt_t bits = 64 + max(0., -log2(scale));
+		if (preciseX.get_prec() < bits) {
+			preciseX.set_prec(bits);
+			preciseY.set_prec(bits);
+		}
+	}
+};
+
+// One image rendered without the terminal interface
+struct RenderJob {
+	FractalType fractal;
+	FractalSettings settings;	// Center, scale (per terminal column) and Julia parameter
+	ColorPalette palette;
+	int maxiter;
+	bool autoMaxiter;			// --maxiter auto
+	int columns;				// Terminal width the scale refers to, the image spans columns * scale
+	int imageWidth, imageHeight;
+	string output;				// Generated like the interactive saves when empty
+	bool smooth;				// Fractional iteration counts
+	SamplePattern samplePattern;	// Supersampling of pixels on edges
+	bool stream;				// Band by band PNG writing
+	string pyramid;				// Directory of a tile pyramid to write instead of a single image
+	int tilesRendered, tilesSkipped, tilesFailed;	// Set by renderJob for pyramids
+	double seconds;				// Set by renderJob
+	string error;				// Set by renderJob when the output could not be written
+	string dump;				// Raw dump written next to the image
+	bool histogram;				// Histogram coloring
+	vector<double> polynomial;	// Replaces the polynomial of a Newton fractal, highest degree first
+};
+
+// Writes a BGR PNG one row at a time, so the image never has to be in memory as a whole
+class PngStreamWriter {
+public:
+	PngStreamWriter() : file(nullptr), png(nullptr), info(nullptr) {}
+	~PngStreamWriter() { finish(); }
+
+	// Same settings as the cv::imwrite exports: compression level 8, RLE strategy
+	bool open(const string& filename, int imageWidth, int imageHeight) {
+		file = fopen(filename.c_str(), "wb");
+		if (!file) return false;
+		png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+		info = png ? png_create_info_struct(png) : nullptr;
+		if (!info || setjmp(png_jmpbuf(png))) return fail();
+		png_init_io(png, file);
+		png_set_IHDR(png, info, imageWidth, imageHeight, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+					 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+		png_set_compression_level(png, 8);
+		png_set_compression_strategy(png, Z_RLE);
+		png_write_info(png, info);
+		png_set_bgr(png);
+		return true;
+	}
+
+	bool writeRow(const cv::Vec3b* row) {
+		if (!png || setjmp(png_jmpbuf(png))) return fail();
+		png_write_row(png, (png_const_bytep)row);
+		return true;
+	}
+
+	bool finish() {
+		if (!png) return false;
+		if (setjmp(png_jmpbuf(png))) return fail();
+		png_write_end(png, nullptr);
+		png_destroy_write_struct(&png, &info);
+		bool closed = fclose(file) == 0;
+		file = nullptr;
+		return closed;
+	}
+
+private:
+	FILE* file;
+	png_structp png;
+	png_infop info;
+
+	bool fail() {
+		if (png) png_destroy_write_struct(&png, info ? &info : nullptr);
+		png = nullptr; info = nullptr;
+		if (file) fclose(file);
+		file = nullptr;
+		return false;
+	}
+};
+
+// Per-pixel results of an export: the header, a uint32 per pixel and, if hasCounts is set, a float per pixel.
+// Escape-time pixels hold their iteration count and their fractional count when smooth, Newton pixels
+// root | iterations << 8. Native byte order. Anti-aliased exports are not dumped, a pixel holds one sample
+struct RawDumpHeader {
+	char magic[8];				// "FRACRAW1"
+	uint32_t width, height;
+	int32_t fractal, maxiter;
+	uint32_t hasCounts, reserved;
+	double centerX, centerY;	// View the export was made from, for reference
+	double pixelScale;
+};
+
+// A raw dump mapped into memory, so tiles write into it directly and recoloring reads only the pages it touches
+class RawDump {
+public:
+	RawDump() : fd(-1), data(nullptr), length(0) {}
+	~RawDump() { close(); }
+
+	bool create(const string& path, const RawDumpHeader& fileHeader) {
+		length = sizeof(RawDumpHeader) + (size_t)fileHeader.width * fileHeader.height * (fileHeader.hasCounts ? 8 : 4);
+		fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (fd < 0 || ftruncate(fd, length) != 0) return close(), false;
+		data = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (data == MAP_FAILED) return data = nullptr, close(), false;
+		memcpy(data, &fileHeader, sizeof fileHeader);
+		return true;
+	}
+
+	bool open(const string& path) {
+		struct stat fileStat;
+		fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0 || fstat(fd, &fileStat) != 0 || (size_t)fileStat.st_size < sizeof(RawDumpHeader)) return close(), false;
+		length = fileStat.st_size;
+		data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED) return data = nullptr, close(), false;
+		const RawDumpHeader& h = header();
+		size_t expected = sizeof(RawDumpHeader) + (size_t)h.width * h.height * (h.hasCounts ? 8 : 4);
+		return memcmp(h.magic, "FRACRAW1", 8) == 0 && length == expected ? true : (close(), false);
+	}
+
+	const RawDumpHeader& header() const { return *(const RawDumpHeader*)data; }
+	uint32_t* values() const { return (uint32_t*)((char*)data + sizeof(RawDumpHeader)); }
+	float* counts() const { return header().hasCounts ? (float*)(values() + (size_t)header().width * header().height) : nullptr; }
+
+	bool close() {
+		bool ok = true;
+		if (data) ok = munmap(data, length) == 0;
+		if (fd >= 0) ok = ::close(fd) == 0 && ok;
+		data = nullptr; fd = -1;
+		return ok;
+	}
+
+private:
+	int fd;
+	void* data;
+	size_t length;
+};
+
+// Fixed set of worker threads sharing index ranges of a single job at a time.
+// The calling thread takes part in the work, so a pool of N workers uses N+1 cores
+class ThreadPool {
+private:
+	vector<thread> workers;
+	mutex submitMutex;			// Serializes parallelFor calls from different threads
+	mutex stateMutex;
+	condition_variable wakeUp, jobDone;
+	const function<void(int, int)>* job;	// Body of the current parallelFor
+	atomic<int> nextIndex;		// First index of the next chunk to hand out
+	int jobEnd, jobGrain;
+	int pendingWorkers;			// Workers that have not finished the current job yet
+	unsigned long long generation;	// Incremented for every new job
+	bool stopping;
+	static thread_local bool insidePool;	// Nested parallelFor calls run serially
+	static thread_local int currentIndex;	// 0 on the calling thread, 1..N on the workers
+
+	void runChunks() {
+		int chunkBegin;
+		while ((chunkBegin = nextIndex.fetch_add(jobGrain)) < jobEnd)
+			(*job)(chunkBegin, min(chunkBegin + jobGrain, jobEnd));
+	}
+
+	void workerLoop(int index) {
+		insidePool = true;
+		currentIndex = index;
+		unsigned long long seenGeneration = 0;
+		unique_lock<mutex> lock(stateMutex);
+		while (true) {
+			wakeUp.wait(lock, [&] { return stopping || generation != seenGeneration; });
+			if (stopping) return;
+			seenGeneration = generation;
+			lock.unlock();
+			runChunks();
+			lock.lock();
+			if (--pendingWorkers == 0) jobDone.notify_one();
+		}
+	}
+
+public:
+	explicit ThreadPool(int threadCount = thread::hardware_concurrency()) :
+		job(nullptr), nextIndex(0), jobEnd(0), jobGrain(1), pendingWorkers(0), generation(0), stopping(false) {
+		for (int i = 1; i < threadCount; ++i)
+			workers.emplace_back(&ThreadPool::workerLoop, this, i);
+	}
+
+	~ThreadPool() {
+		{
+			lock_guard<mutex> lock(stateMutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for (thread& worker : workers) worker.join();
+	}
+
+	int size() const { return workers.size() + 1; }
+
+	// Index in [0, size()) of the pool thread running the current chunk
+	static int threadIndex() { return currentIndex; }
+
+	// Calls body(chunkBegin, chunkEnd) for consecutive chunks of at most grain indices
+	// covering [begin, end). Chunks are handed out dynamically, so uneven work balances itself
+	void parallelFor(int begin, int end, int grain, const function<void(int, int)>& body) {
+		if (begin >= end) return;
+		grain = max(grain, 1);
+		if (workers.empty() || insidePool || end - begin <= grain) {
+			body(begin, end);
+			return;
+		}
+
+		lock_guard<mutex> submitLock(submitMutex);
+		{
+			lock_guard<mutex> lock(stateMutex);
+			job = &body;
+			nextIndex = begin;
+			jobEnd = end;
+			jobGrain = grain;
+			pendingWorkers = workers.size();
+			++generation;
+		}
+		wakeUp.notify_all();
+
+		insidePool = true;
+		runChunks();
+		insidePool = false;
+
+		unique_lock<mutex> lock(stateMutex);
+		jobDone.wait(lock, [this] { return pendingWorkers == 0; });
+		job = nullptr;
+	}
 };
 
+thread_local bool ThreadPool::insidePool = false;
+thread_local int ThreadPool::currentIndex = 0;
+
+// Iteration histogram of a parallel pass. Every pool thread counts into its own bins, allocated on first use,
+// and they are added up once the pass is over
+struct ThreadHistogram {
+	vector<vector<long long>> bins;
+	int binCount;
+
+	ThreadHistogram(int threads, int maxiter) : bins(threads), binCount(maxiter + 1) {}
+
+	vector<long long>& local() {
+		vector<long long>& own = bins[ThreadPool::threadIndex()];
+		if (own.empty()) own.resize(binCount);
+		return own;
+	}
+
+	vector<long long> merge() const {
+		vector<long long> histogram(binCount);
+		for (const vector<long long>& own : bins)
+			for (size_t i = 0; i < own.size(); ++i) histogram[i] += own[i];
+		return histogram;
+	}
+};
+
+enum Arithmetic {
+	ARITH_DOUBLE,
+	ARITH_DOUBLE_DOUBLE,
+	ARITH_QUAD_DOUBLE,
+	ARITH_PERTURBATION,		// Double offsets from a full precision reference orbit
+	ARITH_COUNT
+};
+
+enum SimdLevel {
+	SIMD_NONE,
+	SIMD_AVX2,		// 4 doubles per lane group
+	SIMD_AVX512		// 8 doubles per lane group
+};
+
+// The quadratic escape-time family: z -> z^2 + c with fabs or a sign flip in different places
+enum QuadraticVariant {
+	QUAD_PLAIN,		// Mandelbrot and Julia
+	QUAD_CONJUGATE,	// Tricorn: Im = -2*Re*Im
+	QUAD_ABS_IMAG,	// Burning Ship: Im = 2*|Re*Im|
+	QUAD_ABS_REAL,	// Celtic: Re = |Re^2 - Im^2|
+	QUAD_ABS_BOTH	// Buffalo: both of the above
+};
+
+SimdLevel detectSimdLevel() {
+#ifdef FRACTALS_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#endif
+	return SIMD_NONE;
+}
+
+// Error-free transformations: the rounded result plus the exact rounding error
+inline double twoSum(double a, double b, double& err) {
+	double s = a + b, bb = s - a;
+	err = (a - (s - bb)) + (b - bb);
+	return s;
+}
+
+inline double quickTwoSum(double a, double b, double& err) {	// Needs |a| >= |b|
+	double s = a + b;
+	err = b - (s - a);
+	return s;
+}
+
+inline double twoProd(double a, double b, double& err) {	// Exact only with a fused multiply-add
+	double p = a * b;
+	err = __builtin_fma(a, b, -p);
+	return p;
+}
+
+// Unevaluated sum hi + lo of two doubles, about 106 significant bits
+struct DoubleDouble {
+	double hi, lo;
+
+	DoubleDouble(double value = 0.) : hi(value), lo(0.) {}
+	DoubleDouble(double high, double low) { hi = quickTwoSum(high, low, lo); }
+	double toDouble() const { return hi; }
+};
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+	double e1, e2;
+	double s = twoSum(a.hi, b.hi, e1);
+	double t = twoSum(a.lo, b.lo, e2);
+	e1 += t;
+	s = quickTwoSum(s, e1, e1);
+	e1 += e2;
+	return DoubleDouble(s, e1);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a) {
+	DoubleDouble result;
+	result.hi = -a.hi; result.lo = -a.lo;
+	return result;
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) { return a + -b; }
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+	double err;
+	double p = twoProd(a.hi, b.hi, err);
+	err += a.hi * b.lo + a.lo * b.hi;
+	return DoubleDouble(p, err);
+}
+
+inline DoubleDouble operator*(double a, const DoubleDouble& b) {
+	double err;
+	double p = twoProd(a, b.hi, err);
+	err += a * b.lo;
+	return DoubleDouble(p, err);
+}
+
+inline DoubleDouble fabs(const DoubleDouble& a) { return a.hi < 0 ? -a : a; }
+inline bool operator<(const DoubleDouble& a, double b) { return a.hi < b || (a.hi == b && a.lo < 0); }
+
+// Unevaluated sum of four doubles, about 212 significant bits (Hida, Li and Bailey's "sloppy" algorithms)
+struct QuadDouble {
+	double x[4];
+
+	QuadDouble(double value = 0.) : x{value, 0., 0., 0.} {}
+	QuadDouble(double x0, double x1, double x2, double x3) : x{x0, x1, x2, x3} {}
+	double toDouble() const { return x[0]; }
+};
+
+inline void threeSum(double& a, double& b, double& c) {
+	double t1, t2, t3;
+	t1 = twoSum(a, b, t2);
+	a = twoSum(c, t1, t3);
+	b = twoSum(t2, t3, c);
+}
+
+inline void threeSum2(double& a, double& b, double& c) {
+	double t1, t2, t3;
+	t1 = twoSum(a, b, t2);
+	a = twoSum(c, t1, t3);
+	b = t2 + t3;
+}
+
+// Turns five overlapping components into four non-overlapping ones
+inline QuadDouble renormalize(double c0, double c1, double c2, double c3, double c4) {
+	double s0, s1, s2 = 0., s3 = 0.;
+	if (std::isinf(c0)) return QuadDouble(c0, c1, c2, c3);
+
+	s0 = quickTwoSum(c3, c4, c4);
+	s0 = quickTwoSum(c2, s0, c3);
+	s0 = quickTwoSum(c1, s0, c2);
+	c0 = quickTwoSum(c0, s0, c1);
+
+	s0 = quickTwoSum(c0, c1, s1);
+	if (s1 != 0.) {
+		s1 = quickTwoSum(s1, c2, s2);
+		if (s2 != 0.) {
+			s2 = quickTwoSum(s2, c3, s3);
+			if (s3 != 0.) s3 += c4;
+			else s2 += c4;
+		} else {
+			s1 = quickTwoSum(s1, c3, s2);
+			if (s2 != 0.) s2 = quickTwoSum(s2, c4, s3);
+			else s1 = quickTwoSum(s1, c4, s2);
+		}
+	} else {
+		s0 = quickTwoSum(s0, c2, s1);
+		if (s1 != 0.) {
+			s1 = quickTwoSum(s1, c3, s2);
+			if (s2 != 0.) s2 = quickTwoSum(s2, c4, s3);
+			else s1 = quickTwoSum(s1, c4, s2);
+		} else {
+			s0 = quickTwoSum(s0, c3, s1);
+			if (s1 != 0.) s1 = quickTwoSum(s1, c4, s2);
+			else s0 = quickTwoSum(s0, c4, s1);
+		}
+	}
+	return QuadDouble(s0, s1, s2, s3);
+}
+
+inline QuadDouble operator+(const QuadDouble& a, const QuadDouble& b) {
+	double t0, t1, t2, t3;
+	double s0 = twoSum(a.x[0], b.x[0], t0);
+	double s1 = twoSum(a.x[1], b.x[1], t1);
+	double s2 = twoSum(a.x[2], b.x[2], t2);
+	double s3 = twoSum(a.x[3], b.x[3], t3);
+
+	s1 = twoSum(s1, t0, t0);
+	threeSum(s2, t0, t1);
+	threeSum2(s3, t0, t2);
+	t0 = t0 + t1 + t3;
+	return renormalize(s0, s1, s2, s3, t0);
+}
+
+inline QuadDouble operator-(const QuadDouble& a) { return QuadDouble(-a.x[0], -a.x[1], -a.x[2], -a.x[3]); }
+inline QuadDouble operator-(const QuadDouble& a, const QuadDouble& b) { return a + -b; }
+
+inline QuadDouble operator*(const QuadDouble& a, const QuadDouble& b) {
+	double q0, q1, q2, q3, q4, q5, t0, t1;
+	double p0 = twoProd(a.x[0], b.x[0], q0);
+	double p1 = twoProd(a.x[0], b.x[1], q1);
+	double p2 = twoProd(a.x[1], b.x[0], q2);
+	double p3 = twoProd(a.x[0], b.x[2], q3);
+	double p4 = twoProd(a.x[1], b.x[1], q4);
+	double p5 = twoProd(a.x[2], b.x[0], q5);
+
+	threeSum(p1, p2, q0);
+	threeSum(p2, q1, q2);
+	threeSum(p3, p4, p5);
+	double s0 = twoSum(p2, p3, t0);
+	double s1 = twoSum(q1, p4, t1);
+	double s2 = q2 + p5;
+	s1 = twoSum(s1, t0, t0);
+	s2 += t0 + t1;
+
+	s1 += a.x[0]*b.x[3] + a.x[1]*b.x[2] + a.x[2]*b.x[1] + a.x[3]*b.x[0] + q0 + q3 + q4 + q5;
+	return renormalize(p0, p1, s0, s1, s2);
+}
+
+inline QuadDouble operator*(double a, const QuadDouble& b) {
+	double q0, q1, q2;
+	double p0 = twoProd(b.x[0], a, q0);
+	double p1 = twoProd(b.x[1], a, q1);
+	double p2 = twoProd(b.x[2], a, q2);
+	double p3 = b.x[3] * a;
+
+	double s2, s1 = twoSum(q0, p1, s2);
+	threeSum(s2, q1, p2);
+	threeSum2(q1, q2, p3);
+	return renormalize(p0, s1, s2, q1, q2 + p2);
+}
+
+inline QuadDouble fabs(const QuadDouble& a) { return a.x[0] < 0 ? -a : a; }
+inline bool operator<(const QuadDouble& a, double b) { return a.x[0] < b || (a.x[0] == b && a.x[1] < 0); }
+
+// Rounds a GMP float to the leading components of its expansion
+inline QuadDouble toQuadDouble(const mpf_class& value) {
+	mpf_class rest(value, value.get_prec());
+	double parts[4];
+	for (int i = 0; i < 4; ++i) {
+		parts[i] = rest.get_d();
+		rest -= parts[i];
+	}
+	return renormalize(parts[0], parts[1], parts[2], parts[3], rest.get_d());
+}
+
+inline double toDouble(double value) { return value; }
+inline double toDouble(const DoubleDouble& value) { return value.hi; }
+inline double toDouble(const QuadDouble& value) { return value.x[0]; }
+
+inline void narrow(const QuadDouble& value, QuadDouble& out) { out = value; }
+inline void narrow(const QuadDouble& value, DoubleDouble& out) { out = DoubleDouble(value.x[0], value.x[1]); }
+
+// Main cardioid and period-2 bulb of the Mandelbrot set. Points inside never escape,
+// so the full maxiter iterations can be skipped for them
+inline bool inMainCardioidOrBulb(double cx, double cy) {
+	double xq = cx - 0.25, y2 = cy * cy;
+	double q = xq * xq + y2;
+	if (q * (q + xq) <= 0.25 * y2) return true;
+	return (cx + 1.) * (cx + 1.) + y2 <= 0.0625;
+}
+
+const int NEWTON_LANES = 4;					// Points the Newton kernels iterate together
+constexpr double NEWTON_TOLERANCE = 1e-6;	// Distance to a root at which an orbit has converged
+
+// Roots of a_n z^n + ... + a_0 with real coefficients given highest degree first (a_n != 0): Durand-Kerner,
+// then polished with Newton's method. They are ordered real ones first, then by decreasing real and imaginary
+// part, which keeps the basin colors of the built-in polynomials. Plain double arithmetic, so that the
+// compiler can run it for the specialized kernels
+constexpr void findPolynomialRoots(const double* a, int degree, double* rootsX, double* rootsY) {
+	auto evaluate = [&](double zx, double zy, double& fx, double& fy, double& fpx, double& fpy) {
+		fx = a[0]; fy = 0.; fpx = 0.; fpy = 0.;
+		for (int k = 1; k <= degree; ++k) {
+			double t = fpx * zx - fpy * zy + fx;
+			fpy = fpx * zy + fpy * zx + fy;
+			fpx = t;
+			t = fx * zx - fy * zy + a[k];
+			fy = fx * zy + fy * zx;
+			fx = t;
+		}
+	};
+
+	double seedX = 1., seedY = 0.;	// Powers of 0.4 + 0.9i as starting points
+	for (int k = 0; k < degree; ++k) {
+		rootsX[k] = seedX;
+		rootsY[k] = seedY;
+		double t = seedX * 0.4 - seedY * 0.9;
+		seedY = seedX * 0.9 + seedY * 0.4;
+		seedX = t;
+	}
+	for (int step = 0; step < 1000; ++step) {
+		double change = 0.;
+		for (int k = 0; k < degree; ++k) {
+			double px = a[0], py = 0.;	// a_n times the product of the differences to the other roots
+			for (int j = 0; j < degree; ++j) {
+				if (j == k) continue;
+				double ex = rootsX[k] - rootsX[j], ey = rootsY[k] - rootsY[j];
+				double t = px * ex - py * ey;
+				py = px * ey + py * ex;
+				px = t;
+			}
+			double fx = 0., fy = 0., fpx = 0., fpy = 0.;
+			evaluate(rootsX[k], rootsY[k], fx, fy, fpx, fpy);
+			double norm = px * px + py * py;
+			double deltaX = (fx * px + fy * py) / norm, deltaY = (fy * px - fx * py) / norm;
+			rootsX[k] -= deltaX;
+			rootsY[k] -= deltaY;
+			change = max(change, deltaX * deltaX + deltaY * deltaY);
+		}
+		if (change < 1e-30) break;
+	}
+	for (int k = 0; k < degree; ++k) {
+		for (int step = 0; step < 5; ++step) {
+			double fx = 0., fy = 0., fpx = 0., fpy = 0.;
+			evaluate(rootsX[k], rootsY[k], fx, fy, fpx, fpy);
+			double denom = fpx * fpx + fpy * fpy;
+			if (denom == 0.) break;
+			rootsX[k] -= (fx * fpx + fy * fpy) / denom;
+			rootsY[k] -= (fy * fpx - fx * fpy) / denom;
+		}
+		if (rootsY[k] > -1e-12 && rootsY[k] < 1e-12) rootsY[k] = 0.;
+	}
+	for (int k = 1; k < degree; ++k) {
+		for (int j = k; j > 0; --j) {
+			bool realJ = rootsY[j] == 0., realPrevious = rootsY[j - 1] == 0.;
+			bool before = realJ != realPrevious ? realJ :
+						  rootsX[j] != rootsX[j - 1] ? rootsX[j] > rootsX[j - 1] : rootsY[j] > rootsY[j - 1];
+			if (!before) break;
+			double t = rootsX[j]; rootsX[j] = rootsX[j - 1]; rootsX[j - 1] = t;
+			t = rootsY[j]; rootsY[j] = rootsY[j - 1]; rootsY[j - 1] = t;
+		}
+	}
+}
+
+// Square root that also runs at compile time (Newton's method, x >= 0)
+constexpr double constexprSqrt(double x) {
+	if (x <= 0. || x != x || x > 1e300) return x;	// 0, NaN and huge values as they are
+	double root = x < 1. ? 1. : x;
+	for (int step = 0; step < 200; ++step) {
+		double next = 0.5 * (root + x / root);
+		if (next >= root) break;
+		root = next;
+	}
+	return root;
+}
+
+// Squared length of the longest Newton step after which the convergence test looks for a root. Near a root r
+// the distance e shrinks to about K e^2 per step with K = |f''(r) / 2f'(r)|, so the step that brings an orbit
+// within the tolerance is at most about sqrt(tolerance / K) long; four times that for the roughest root, but no
+// more than half the smallest distance between roots, and never below the tolerance. Orbits are mostly far
+// from that close, which lets most iterations skip the root test
+constexpr double longestArrivalStep2(const double* a, int degree, const double* rootsX, const double* rootsY) {
+	double longest = 0., closest = 1e300;
+	for (int j = 0; j < degree; ++j) {
+		double fx = a[0], fy = 0., fpx = 0., fpy = 0., fppx = 0., fppy = 0.;	// f, f' and f''/2 by Horner's scheme
+		for (int k = 1; k <= degree; ++k) {
+			double t = fppx * rootsX[j] - fppy * rootsY[j] + fpx;
+			fppy = fppx * rootsY[j] + fppy * rootsX[j] + fpy;
+			fppx = t;
+			t = fpx * rootsX[j] - fpy * rootsY[j] + fx;
+			fpy = fpx * rootsY[j] + fpy * rootsX[j] + fy;
+			fpx = t;
+			t = fx * rootsX[j] - fy * rootsY[j] + a[k];
+			fy = fx * rootsY[j] + fy * rootsX[j];
+			fx = t;
+		}
+		double k2 = (fppx * fppx + fppy * fppy) / (fpx * fpx + fpy * fpy);	// K^2
+		longest = max(longest, k2 > 0. ? 16 * NEWTON_TOLERANCE / constexprSqrt(k2) : 1e300);
+		for (int i = j + 1; i < degree; ++i) {
+			double dx = rootsX[i] - rootsX[j], dy = rootsY[i] - rootsY[j];
+			closest = min(closest, dx * dx + dy * dy);
+		}
+	}
+	return max(min(longest, closest / 4), NEWTON_TOLERANCE * NEWTON_TOLERANCE);
+}
+
+// Polynomial of a Newton fractal known only at run time, of any degree. Newton kernels call evaluate for
+// NEWTON_LANES points at once and root after each step shorter than arrivalStep2
+struct NewtonPolynomial {
+	vector<double> coefficients;	// a_n ... a_0 of a_n z^n + ... + a_0, a_n != 0
+	vector<double> rootsX, rootsY;
+	double arrivalStep;				// longestArrivalStep2 of the roots
+
+	// Square grid over the roots, cell c lists the roots within reach of it in cellRoots[cellStart[c]] up to
+	// cellRoots[cellStart[c + 1]], so a point finds its root among one or two candidates at any degree
+	double gridX0, gridY0, inverseCellSize;
+	int gridSize;
+	vector<int> cellStart, cellRoots;
+
+	NewtonPolynomial() : arrivalStep(0.), gridX0(0.), gridY0(0.), inverseCellSize(0.), gridSize(0) {}
+	explicit NewtonPolynomial(const vector<double>& highestFirst) : coefficients(highestFirst) {
+		while (coefficients.size() > 1 && coefficients[0] == 0.) coefficients.erase(coefficients.begin());
+		int n = max(degree(), 0);
+		rootsX.resize(n);
+		rootsY.resize(n);
+		findPolynomialRoots(coefficients.data(), n, rootsX.data(), rootsY.data());
+		arrivalStep = longestArrivalStep2(coefficients.data(), n, rootsX.data(), rootsY.data());
+		buildGrid();
+	}
+
+	// About four cells per root. A root is listed in every cell within twice the tolerance of it, so the
+	// cell of a point within the tolerance lists it despite rounding
+	void buildGrid() {
+		int n = rootsX.size();
+		double reach = 2 * NEWTON_TOLERANCE;
+		double minX = 0., maxX = 0., minY = 0., maxY = 0.;
+		if (n > 0) {
+			minX = *min_element(rootsX.begin(), rootsX.end()); maxX = *max_element(rootsX.begin(), rootsX.end());
+			minY = *min_element(rootsY.begin(), rootsY.end()); maxY = *max_element(rootsY.begin(), rootsY.end());
+		}
+		gridSize = max(1, (int)ceil(2 * sqrt(n)));
+		gridX0 = minX - reach;
+		gridY0 = minY - reach;
+		inverseCellSize = gridSize / (max(maxX - minX, maxY - minY) + 2 * reach);
+
+		vector<vector<int>> cells(gridSize * gridSize);
+		auto cellOf = [&](double value, double origin) {
+			return min(max((int)floor((value - origin) * inverseCellSize), 0), gridSize - 1);
+		};
+		for (int j = 0; j < n; ++j)
+			for (int y = cellOf(rootsY[j] - reach, gridY0); y <= cellOf(rootsY[j] + reach, gridY0); ++y)
+				for (int x = cellOf(rootsX[j] - reach, gridX0); x <= cellOf(rootsX[j] + reach, gridX0); ++x)
+					cells[y * gridSize + x].push_back(j);
+		cellStart.assign(1, 0);
+		cellRoots.clear();
+		for (const vector<int>& cell : cells) {
+			cellRoots.insert(cellRoots.end(), cell.begin(), cell.end());
+			cellStart.push_back(cellRoots.size());
+		}
+	}
+
+	int degree() const { return coefficients.size() - 1; }
+
+	// f and f' at the points of all lanes by Horner's scheme, the lanes interleaved so their steps overlap
+	void evaluate(const double* zx, const double* zy, double* fx, double* fy, double* fpx, double* fpy) const {
+		const double* a = coefficients.data();
+		for (int l = 0; l < NEWTON_LANES; ++l) {
+			fpx[l] = a[0]; fpy[l] = 0;	// First step of both, the leading coefficient is real
+			fx[l] = a[0] * zx[l] + a[1]; fy[l] = a[0] * zy[l];
+		}
+		for (int k = 2; k <= degree(); ++k) {
+			for (int l = 0; l < NEWTON_LANES; ++l) {
+				double t = fpx[l] * zx[l] - fpy[l] * zy[l] + fx[l];
+				fpy[l] = fpx[l] * zy[l] + fpy[l] * zx[l] + fy[l];
+				fpx[l] = t;
+				t = fx[l] * zx[l] - fy[l] * zy[l] + a[k];
+				fy[l] = fx[l] * zy[l] + fy[l] * zx[l];
+				fx[l] = t;
+			}
+		}
+	}
+
+	double arrivalStep2() const { return arrivalStep; }
+
+	// 1 + the index of the root z is within NEWTON_TOLERANCE of, 0 if there is none
+	int root(double zx, double zy) const {
+		double cellX = (zx - gridX0) * inverseCellSize, cellY = (zy - gridY0) * inverseCellSize;
+		if (!(cellX >= 0. && cellX < gridSize && cellY >= 0. && cellY < gridSize)) return 0;	// Also rejects NaN
+		int cell = (int)cellY * gridSize + (int)cellX;
+		for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+			int j = cellRoots[i];
+			double dx_root = zx - rootsX[j], dy_root = zy - rootsY[j];
+			if (dx_root * dx_root + dy_root * dy_root < NEWTON_TOLERANCE * NEWTON_TOLERANCE) return j + 1;
+		}
+		return 0;
+	}
+};
+
+// Polynomial fixed at compile time, Coefficients::values holds a_n ... a_0. The compiler also finds its roots,
+// so Horner's scheme and the root check unroll into straight code with every constant folded in, and zero
+// coefficients drop out, as in a hand-expanded kernel. Same interface as NewtonPolynomial
+template<class Coefficients>
+struct StaticPolynomial {
+	static constexpr int DEGREE = size(Coefficients::values) - 1;
+	struct Roots { double x[DEGREE], y[DEGREE]; };
+	static constexpr Roots roots = [] {
+		Roots found{};
+		findPolynomialRoots(Coefficients::values, DEGREE, found.x, found.y);
+		return found;
+	}();
+	static constexpr double ARRIVAL_STEP2 = longestArrivalStep2(Coefficients::values, DEGREE, roots.x, roots.y);
+
+	static constexpr double arrivalStep2() { return ARRIVAL_STEP2; }
+
+	static void evaluate(const double* zx, const double* zy, double* fx, double* fy, double* fpx, double* fpy) {
+		constexpr double a0 = Coefficients::values[0], a1 = Coefficients::values[1];
+		for (int l = 0; l < NEWTON_LANES; ++l) {
+			fpx[l] = a0; fpy[l] = 0;
+			fx[l] = a0 * zx[l]; fy[l] = a0 * zy[l];
+			if constexpr (a1 != 0.) fx[l] += a1;
+		}
+		hornerSteps(zx, zy, fx, fy, fpx, fpy, make_index_sequence<DEGREE - 1>());
+	}
+
+	template<size_t... K>
+	static void hornerSteps(const double* zx, const double* zy, double* fx, double* fy, double* fpx, double* fpy, index_sequence<K...>) {
+		(hornerStep<K + 2>(zx, zy, fx, fy, fpx, fpy), ...);
+	}
+
+	template<int K>
+	static void hornerStep(const double* zx, const double* zy, double* fx, double* fy, double* fpx, double* fpy) {
+		for (int l = 0; l < NEWTON_LANES; ++l) {
+			double t = fpx[l] * zx[l] - fpy[l] * zy[l] + fx[l];
+			fpy[l] = fpx[l] * zy[l] + fpy[l] * zx[l] + fy[l];
+			fpx[l] = t;
+			t = fx[l] * zx[l] - fy[l] * zy[l];
+			if constexpr (Coefficients::values[K] != 0.) t += Coefficients::values[K];
+			fy[l] = fx[l] * zy[l] + fy[l] * zx[l];
+			fx[l] = t;
+		}
+	}
+
+	static int root(double zx, double zy) {
+		return root(zx, zy, make_index_sequence<DEGREE>());
+	}
+
+	template<size_t... J>
+	static int root(double zx, double zy, index_sequence<J...>) {
+		int found = 0;
+		(void)((near<J>(zx, zy) && (found = J + 1)) || ...);	// Stops at the first root in reach
+		return found;
+	}
+
+	template<int J>
+	static bool near(double zx, double zy) {
+		double dx_root = zx - roots.x[J], dy_root = zy - roots.y[J];
+		return dx_root * dx_root + dy_root * dy_root < NEWTON_TOLERANCE * NEWTON_TOLERANCE;
+	}
+};
+
+// Polynomials of the built-in Newton fractals
+struct Newton1Coefficients { static constexpr double values[] = {1, 0, 0, -1}; };			// z^3 - 1
+struct Newton2Coefficients { static constexpr double values[] = {1, 0, -2, 2}; };			// z^3 - 2z + 2
+struct Newton3Coefficients { static constexpr double values[] = {1, 0, 0, 1, 0, -1}; };	// z^5 + z^2 - 1
+
+// Counters bumped by the kernels on the thread that runs them
+struct KernelStats {
+	long long bulbHits;		// Mandelbrot points resolved by inMainCardioidOrBulb
+	long long cycleHits;	// Points whose orbit was found to be periodic
+	long long rebases;		// Perturbed orbits moved back to the start of the reference orbit
+	long long perturbedIterations;	// Iterations of perturbed orbits
+	long long blaSkipped;	// ... of which were covered by BLA steps
+	long long escapeIterations;	// Iterations the escape-time kernels ran; interior shortcuts add only those before them
+	long long newtonIterations;	// Iterations of the Newton kernels, which return a root instead of their count
+	long long refinedPixels;	// Export pixels supersampled because their neighbours differ
+	long long points;		// Points evaluated
+
+	KernelStats() : bulbHits(0), cycleHits(0), rebases(0), perturbedIterations(0), blaSkipped(0), escapeIterations(0), newtonIterations(0), refinedPixels(0), points(0) {}
+
+	void add(const KernelStats& other) {
+		bulbHits += other.bulbHits;
+		cycleHits += other.cycleHits;
+		rebases += other.rebases;
+		perturbedIterations += other.perturbedIterations;
+		blaSkipped += other.blaSkipped;
+		escapeIterations += other.escapeIterations;
+		newtonIterations += other.newtonIterations;
+		refinedPixels += other.refinedPixels;
+		points += other.points;
+	}
+};
+
+// Maps pixel (x, y) of a render target to the point ((x - halfWidth) * stepX + centerX, (y - halfHeight) * stepY + centerY)
+struct PixelGrid {
+	double halfWidth, halfHeight;
+	double stepX, stepY;
+	double centerX, centerY;
+
+	double pointX(double x) const { return (x - halfWidth) * stepX + centerX; }	// Fractional x and y for subpixel samples
+	double pointY(double y) const { return (y - halfHeight) * stepY + centerY; }
+};
+
+// Everything that decides the values of a terminal frame apart from its center
+struct FrameKey {
+	int fractal;
+	int width, height, maxiter;
+	double scaleX, scaleY;
+	double juliaCx, juliaCy;
+	bool subdivision;
+	mpf_class centerX, centerY;
+
+	bool sameExceptCenter(const FrameKey& other) const {
+		return fractal == other.fractal && width == other.width && height == other.height && maxiter == other.maxiter &&
+			   scaleX == other.scaleX && scaleY == other.scaleY && juliaCx == other.juliaCx && juliaCy == other.juliaCy &&
+			   subdivision == other.subdivision;
+	}
+};
+
+// View an automatic maxiter was chosen for. Pans keep it, so a pan does not change maxiter under a reused frame
+struct TunedView {
+	int fractal;
+	int width, height;
+	double stepX, stepY;
+	double juliaCx, juliaCy;
+	int maxiter;				// Chosen for the view, not part of the comparison
+
+	bool operator==(const TunedView& other) const {
+		return fractal == other.fractal && width == other.width && height == other.height && stepX == other.stepX &&
+			   stepY == other.stepY && juliaCx == other.juliaCx && juliaCy == other.juliaCy;
+	}
+};
+
+// Orbit of the view center computed in full precision and rounded to doubles. Deep zoom pixels only
+// iterate their small difference from it (perturbation), which double handles at any depth
+struct ReferenceOrbit {
+	vector<double> zx, zy;	// Z_0 ... Z_last, ends with the first escaped value if the center escapes
+	// What the orbit was computed for
+	int fractal, maxiter;
+	double juliaCx, juliaCy;
+	mpf_class centerX, centerY;
+	unsigned generation;	// Bumped whenever the orbit is recomputed
+
+	ReferenceOrbit() : fractal(-1), maxiter(0), juliaCx(0), juliaCy(0), generation(0) {}
+};
+
+// Bilinear approximation: l iterations starting at reference index m turn delta into A*delta + B*delta_c
+// as long as |delta| < r, i.e. while delta^2 is negligible next to the linear terms
+struct BlaStep {
+	double ax, ay, bx, by;
+	double r;
+};
+
+// BLA steps of a reference orbit. levels[k][j] covers 2^k iterations starting at reference index 1 + j*2^k
+// and is built by merging levels[k-1][2j] and levels[k-1][2j+1]
+struct BlaTable {
+	vector<vector<BlaStep>> levels;
+	// What the table was built for
+	unsigned orbitGeneration;
+	double maxDc;
+
+	BlaTable() : orbitGeneration(0), maxDc(-1) {}
+};
+
+// What the escape-time kernels need besides the points themselves
+struct EscapeParams {
+	double juliaCx, juliaCy;	// c of the Julia set
+	int maxiter;
+	double cycleTolerance;		// An orbit coming back this close to its saved point is periodic
+};
+
+#ifdef FRACTALS_X86_SIMD
+// Vector versions of mandelbrotPoint, tricornPoint, juliaPoint, burningShipPoint, celticPoint and buffaloPoint.
+// Points (px[i], py[i]) are c for the Mandelbrot-like types and z0 for Julia (then c = juliaCx + i*juliaCy).
+// A lane stops counting once it escapes and the group stops when every lane has escaped.
+// For Mandelbrot, lanes inside the main cardioid or period-2 bulb start out escaped at maxiter.
+// Periodic orbits are detected like in FractalRenderer::escapeTime; the lanes run in lockstep, so they share the save points.
+// The operations mirror the scalar code one to one and must not be fused into FMAs (AVX-512 implies FMA),
+// so the counts are identical to the scalar ones
+template<int Variant, bool Julia>
+__attribute__((target("avx2"), optimize("fp-contract=off")))
+void quadraticKernelAvx2(const double* px, const double* py, int n, const EscapeParams& params, int* out, KernelStats& stats) {
+	const __m256d four = _mm256_set1_pd(4.), one = _mm256_set1_pd(1.);
+	const __m256d two = _mm256_set1_pd(Variant == QUAD_CONJUGATE ? -2. : 2.);
+	const __m256d signBit = _mm256_set1_pd(-0.);
+	const __m256d tolerance = _mm256_set1_pd(params.cycleTolerance), maxiter = _mm256_set1_pd(params.maxiter);
+	double lanesX[4], lanesY[4], result[4];
+
+	for (int i = 0; i < n; i += 4) {
+		int count = min(4, n - i);
+		for (int j = 0; j < 4; ++j) {	// The tail is padded with copies of the last point
+			lanesX[j] = px[i + min(j, count - 1)];
+			lanesY[j] = py[i + min(j, count - 1)];
+		}
+		__m256d x = _mm256_loadu_pd(lanesX), y = _mm256_loadu_pd(lanesY);
+		__m256d zx = Julia ? x : _mm256_setzero_pd(), zy = Julia ? y : _mm256_setzero_pd();
+		__m256d cx = Julia ? _mm256_set1_pd(params.juliaCx) : x, cy = Julia ? _mm256_set1_pd(params.juliaCy) : y;
+		__m256d zx2 = _mm256_mul_pd(zx, zx), zy2 = _mm256_mul_pd(zy, zy);
+		__m256d iterations = _mm256_setzero_pd();
+		__m256d active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+		__m256d settled = _mm256_setzero_pd();	// Lanes an interior shortcut set to maxiter
+
+		if (Variant == QUAD_PLAIN && !Julia) {
+			__m256d xq = _mm256_sub_pd(x, _mm256_set1_pd(0.25)), y2 = _mm256_mul_pd(y, y);
+			__m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), y2);
+			__m256d inCardioid = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xq)), _mm256_mul_pd(_mm256_set1_pd(0.25), y2), _CMP_LE_OQ);
+			__m256d xb = _mm256_add_pd(x, one);
+			__m256d inBulb = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(xb, xb), y2), _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+			__m256d interior = _mm256_or_pd(inCardioid, inBulb);
+			iterations = _mm256_and_pd(interior, maxiter);
+			active = _mm256_andnot_pd(interior, active);
+			settled = interior;
+			stats.bulbHits += __builtin_popcount(_mm256_movemask_pd(interior) & ((1 << count) - 1));
+		}
+
+		__m256d savedX = zx, savedY = zy;
+		int nextSave = 1;
+
+		for (int k = 0; k < params.maxiter; ++k) {
+			active = _mm256_and_pd(active, _mm256_cmp_pd(_mm256_add_pd(zx2, zy2), four, _CMP_LT_OQ));
+			if (_mm256_testz_pd(active, active)) break;
+			iterations = _mm256_add_pd(iterations, _mm256_and_pd(active, one));
+
+			if (Variant == QUAD_ABS_IMAG || Variant == QUAD_ABS_BOTH)
+				zy = _mm256_add_pd(_mm256_mul_pd(two, _mm256_andnot_pd(signBit, _mm256_mul_pd(zx, zy))), cy);
+			else
+				zy = _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(two, zx), zy), cy);
+			__m256d re = _mm256_sub_pd(zx2, zy2);
+			if (Variant == QUAD_ABS_REAL || Variant == QUAD_ABS_BOTH)
+				re = _mm256_andnot_pd(signBit, re);
+			zx = _mm256_add_pd(re, cx);
+			zx2 = _mm256_mul_pd(zx, zx); zy2 = _mm256_mul_pd(zy, zy);
+
+			__m256d nearX = _mm256_cmp_pd(_mm256_andnot_pd(signBit, _mm256_sub_pd(zx, savedX)), tolerance, _CMP_LT_OQ);
+			__m256d nearY = _mm256_cmp_pd(_mm256_andnot_pd(signBit, _mm256_sub_pd(zy, savedY)), tolerance, _CMP_LT_OQ);
+			__m256d periodic = _mm256_and_pd(active, _mm256_and_pd(nearX, nearY));
+			if (!_mm256_testz_pd(periodic, periodic)) {
+				iterations = _mm256_blendv_pd(iterations, maxiter, periodic);
+				active = _mm256_andnot_pd(periodic, active);
+				settled = _mm256_or_pd(settled, periodic);
+				int periodicLanes = __builtin_popcount(_mm256_movemask_pd(periodic) & ((1 << count) - 1));
+				stats.cycleHits += periodicLanes;
+				stats.escapeIterations += (long long)(k + 1) * periodicLanes;
+			}
+			if (k + 1 == nextSave) {
+				savedX = zx; savedY = zy;
+				nextSave *= 2;
+			}
+		}
+
+		_mm256_storeu_pd(result, iterations);
+		int settledLanes = _mm256_movemask_pd(settled);
+		for (int j = 0; j < count; ++j) {
+			out[i + j] = result[j];
+			if (!(settledLanes >> j & 1)) stats.escapeIterations += out[i + j];
+		}
+	}
+}
+
+template<int Variant, bool Julia>
+__attribute__((target("avx512f"), optimize("fp-contract=off")))
+void quadraticKernelAvx512(const double* px, const double* py, int n, const EscapeParams& params, int* out, KernelStats& stats) {
+	const __m512d four = _mm512_set1_pd(4.), one = _mm512_set1_pd(1.);
+	const __m512d two = _mm512_set1_pd(Variant == QUAD_CONJUGATE ? -2. : 2.);
+	const __m512d tolerance = _mm512_set1_pd(params.cycleTolerance), maxiter = _mm512_set1_pd(params.maxiter);
+	double result[8];
+
+	for (int i = 0; i < n; i += 8) {
+		int count = min(8, n - i);
+		__mmask8 loadMask = (1 << count) - 1;	// Masked-off lanes stay at zero and are never stored
+		__m512d x = _mm512_maskz_loadu_pd(loadMask, px + i), y = _mm512_maskz_loadu_pd(loadMask, py + i);
+		__m512d zx = Julia ? x : _mm512_setzero_pd(), zy = Julia ? y : _mm512_setzero_pd();
+		__m512d cx = Julia ? _mm512_set1_pd(params.juliaCx) : x, cy = Julia ? _mm512_set1_pd(params.juliaCy) : y;
+		__m512d zx2 = _mm512_mul_pd(zx, zx), zy2 = _mm512_mul_pd(zy, zy);
+		__m512d iterations = _mm512_setzero_pd();
+		__mmask8 active = loadMask;
+		__mmask8 settled = 0;	// Lanes an interior shortcut set to maxiter
+
+		if (Variant == QUAD_PLAIN && !Julia) {
+			__m512d xq = _mm512_sub_pd(x, _mm512_set1_pd(0.25)), y2 = _mm512_mul_pd(y, y);
+			__m512d q = _mm512_add_pd(_mm512_mul_pd(xq, xq), y2);
+			__mmask8 inCardioid = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xq)), _mm512_mul_pd(_mm512_set1_pd(0.25), y2), _CMP_LE_OQ);
+			__m512d xb = _mm512_add_pd(x, one);
+			__mmask8 inBulb = _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(xb, xb), y2), _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+			__mmask8 interior = (inCardioid | inBulb) & loadMask;
+			iterations = _mm512_mask_mov_pd(iterations, interior, maxiter);
+			active &= ~interior;
+			settled = interior;
+			stats.bulbHits += __builtin_popcount(interior);
+		}
+
+		__m512d savedX = zx, savedY = zy;
+		int nextSave = 1;
+
+		for (int k = 0; k < params.maxiter; ++k) {
+			active = _mm512_mask_cmp_pd_mask(active, _mm512_add_pd(zx2, zy2), four, _CMP_LT_OQ);
+			if (active == 0) break;
+			iterations = _mm512_mask_add_pd(iterations, active, iterations, one);
+
+			if (Variant == QUAD_ABS_IMAG || Variant == QUAD_ABS_BOTH)
+				zy = _mm512_add_pd(_mm512_mul_pd(two, _mm512_abs_pd(_mm512_mul_pd(zx, zy))), cy);
+			else
+				zy = _mm512_add_pd(_mm512_mul_pd(_mm512_mul_pd(two, zx), zy), cy);
+			__m512d re = _mm512_sub_pd(zx2, zy2);
+			if (Variant == QUAD_ABS_REAL || Variant == QUAD_ABS_BOTH)
+				re = _mm512_abs_pd(re);
+			zx = _mm512_add_pd(re, cx);
+			zx2 = _mm512_mul_pd(zx, zx); zy2 = _mm512_mul_pd(zy, zy);
+
+			__mmask8 periodic = _mm512_mask_cmp_pd_mask(active, _mm512_abs_pd(_mm512_sub_pd(zx, savedX)), tolerance, _CMP_LT_OQ);
+			periodic = _mm512_mask_cmp_pd_mask(periodic, _mm512_abs_pd(_mm512_sub_pd(zy, savedY)), tolerance, _CMP_LT_OQ);
+			if (periodic) {
+				iterations = _mm512_mask_mov_pd(iterations, periodic, maxiter);
+				active &= ~periodic;
+				settled |= periodic;
+				stats.cycleHits += __builtin_popcount(periodic);
+				stats.escapeIterations += (long long)(k + 1) * __builtin_popcount(periodic);
+			}
+			if (k + 1 == nextSave) {
+				savedX = zx; savedY = zy;
+				nextSave *= 2;
+			}
+		}
+
+		_mm512_storeu_pd(result, iterations);
+		for (int j = 0; j < count; ++j) {
+			out[i + j] = result[j];
+			if (!(settled >> j & 1)) stats.escapeIterations += out[i + j];
+		}
+	}
+}
+#endif
+
+// Runs the widest kernel the CPU supports. Returns false when there is none and the caller has to use the scalar code
+template<int Variant, bool Julia>
+bool quadraticKernel(SimdLevel level, const double* px, const double* py, int n, const EscapeParams& params, int* out, KernelStats& stats) {
+#ifdef FRACTALS_X86_SIMD
+	switch (level) {
+		case SIMD_AVX512:	quadraticKernelAvx512<Variant, Julia>(px, py, n, params, out, stats); return true;
+		case SIMD_AVX2:		quadraticKernelAvx2<Variant, Julia>(px, py, n, params, out, stats); return true;
+		default: break;
+	}
+#endif
+	return false;
+}
+
 class FractalRenderer {
 private:
 	FractalSettings fractalSettings[FRACTAL_COUNT]; // Array of settings for each fractal
+	FractalSettings defaultSettings[FRACTAL_COUNT];	// Settings of the constructor, every command line job starts from them
 	FractalType currentFractal; // Data about current fractal
 	ColorPalette currentPalette;// For saving .png
 	double aspectRatio;			// Symbol height/width
 	double scaleX, scaleY;
 	int width, height;			// Height and width of the terminal in symbols
 	int maxiter;				// Maximum number of iterations
+	bool autoMaxiter;			// maxiter follows the escape statistics of the view (escape-time fractals)
+	TunedView tunedView;		// View the automatic maxiter belongs to
+	NewtonPolynomial newtonPolynomials[3];	// Of NEWTON_1, NEWTON_2 and NEWTON_3
+	bool genericNewtonKernel[3];	// Set when the polynomial was replaced, there is no compile-time kernel for it then
 	bool running;				// Breaking the while cycle in main()
 	const char* fractalNamesSpaces[FRACTAL_COUNT] = {"Mandelbrot          ", "Mandelbrot Sin      ", "Inverted Mandelbrot ", "Tricorn             ", 
 													"Julia               ", "Burning Ship        ", "Celtic              ", "Buffalo             ", 
@@ -69,56 +1200,92 @@ private:
 	const char* fractalNames[FRACTAL_COUNT] = {"Mandelbrot", "Mandelbrot Sin", "Inverted Mandelbrot", "Tricorn", "Julia", "Burning Ship", "Celtic", "Buffalo", "Newton z^3 - 1", "Newton z^3 - 2z + 2", "Newton z^5 + z^2 - 1"};
 	const char* paletteNames[PALETTE_COUNT] = {"Grayscale", "Fire", "Ocean", "Forest"};
 	vector<int> compressionParams;
+	ThreadPool pool;			// Workers shared by every render and save
+	vector<int> frameBuffer;	// Iteration counts (or Newton root indices) of the terminal frame
+	SimdLevel simdLevel;		// Widest vector kernels this CPU can run
+	static thread_local KernelStats threadStats;	// Counters of the kernels running on this thread
+	KernelStats frameStats;		// Counters of the last terminal frame or export
+	mutex statsMutex;
+	double cycleTolerance;		// Periodicity check tolerance, follows the pixel spacing of the current render
+	bool subdivision;			// Mariani-Silver rectangle subdivision instead of evaluating every pixel
+	FrameKey lastFrame;			// View frameBuffer was computed for
+	bool lastFrameValid;
+	int reusedCells;			// Cells of the last frame taken over from the one before
+	Arithmetic arithmetic;		// Number type of the current render, follows the pixel spacing
+	const char* arithmeticNames[ARITH_COUNT] = {"double", "double-double", "quad-double", "perturbation"};
+	bool hasFma;				// CPU has fused multiply-add for the extended precision types
+	QuadDouble extendedCenterX, extendedCenterY;	// View center for the extended precision types
+	ReferenceOrbit reference;
+	BlaTable bla;
+	bool useBla;				// Current perturbed render can skip iterations with the BLA table
+	double gamma;				// Brightness curve of the palettes
+	PaletteLut lut;				// Rebuilt when the palette, maxiter or gamma change
+	bool histogramColoring;		// Palette positions from the distribution of counts instead of the gamma curve
+	PaletteLut equalizedLut;	// Palette table of the last histogram
+	cv::Mat exportBuffer;		// Export image or band, kept between exports of a batch
+	bool streamExport;			// Exports are computed and written a band of rows at a time
+	string dumpPath;			// Exports also write their raw per-pixel results here when set
+	uint32_t* dumpValues;		// Raw per-pixel results of the running export (a mapped dump or a buffer), or nullptr
+	float* dumpCounts;
+	bool smooth;				// Exports color fractional iteration counts instead of whole ones
+	SamplePattern samplePattern;	// Supersampling of export pixels on edges
+	const char* samplePatternNames[SAMPLE_PATTERN_COUNT] = {"off", "grid2", "grid3", "grid4", "rotated4"};
+	double bailout;				// Squared escape radius of the escape-time kernels
+	static thread_local double escapeNorm;	// |z|^2 the last escape-time kernel on this thread escaped with
 
 public:
-	FractalRenderer(): currentFractal(MANDELBROT), currentPalette(GRAYSCALE), aspectRatio(2.11), running(true), maxiter(300) {
-		fractalSettings[MANDELBROT].centerX = -0.5;
-		fractalSettings[MANDELBROT].centerY = 0.0;
+	FractalRenderer(): currentFractal(MANDELBROT), currentPalette(GRAYSCALE), aspectRatio(2.11), running(true), maxiter(300), autoMaxiter(false), tunedView(), subdivision(false), lastFrameValid(false), reusedCells(0), arithmetic(ARITH_DOUBLE), useBla(false), gamma(2.2), histogramColoring(false), streamExport(false), dumpValues(nullptr), dumpCounts(nullptr), smooth(false), samplePattern(SAMPLES_OFF), bailout(4.) {
+		fractalSettings[MANDELBROT].setCenter(-0.5, 0.0);
 		fractalSettings[MANDELBROT].scale = 0.015;
 
-		fractalSettings[MANDELBROT_SIN].centerX = 0.0;
-		fractalSettings[MANDELBROT_SIN].centerY = 0.0;
+		fractalSettings[MANDELBROT_SIN].setCenter(0.0, 0.0);
 		fractalSettings[MANDELBROT_SIN].scale = 0.05;
 
-		fractalSettings[MANDELBROT_INV].centerX = 0.8;
-		fractalSettings[MANDELBROT_INV].centerY = 0.0;
+		fractalSettings[MANDELBROT_INV].setCenter(0.8, 0.0);
 		fractalSettings[MANDELBROT_INV].scale = 0.025;
 
-		fractalSettings[TRICORN].centerX = 0.0;
-		fractalSettings[TRICORN].centerY = 0.0;
+		fractalSettings[TRICORN].setCenter(0.0, 0.0);
 		fractalSettings[TRICORN].scale = 0.02;
 
-		fractalSettings[JULIA].centerX = 0.0;
-		fractalSettings[JULIA].centerY = 0.0;
+		fractalSettings[JULIA].setCenter(0.0, 0.0);
 		fractalSettings[JULIA].scale = 0.015;
 		fractalSettings[JULIA].juliaCx = -0.7;
 		fractalSettings[JULIA].juliaCy = 0.27;
 
-		fractalSettings[BURNING_SHIP].centerX = -0.5;
-		fractalSettings[BURNING_SHIP].centerY = -0.5;
+		fractalSettings[BURNING_SHIP].setCenter(-0.5, -0.5);
 		fractalSettings[BURNING_SHIP].scale = 0.02;
 
-		fractalSettings[CELTIC].centerX = -0.6;
-		fractalSettings[CELTIC].centerY = -0.0;
+		fractalSettings[CELTIC].setCenter(-0.6, -0.0);
 		fractalSettings[CELTIC].scale = 0.02;
 
-		fractalSettings[BUFFALO].centerX = -0.5;
-		fractalSettings[BUFFALO].centerY = -0.5;
+		fractalSettings[BUFFALO].setCenter(-0.5, -0.5);
 		fractalSettings[BUFFALO].scale = 0.02;
 
-		fractalSettings[NEWTON_1].centerX = 0.0;
-		fractalSettings[NEWTON_1].centerY = 0.0;
+		fractalSettings[NEWTON_1].setCenter(0.0, 0.0);
 		fractalSettings[NEWTON_1].scale = 0.02;
 
-		fractalSettings[NEWTON_2].centerX = 0.0;
-		fractalSettings[NEWTON_2].centerY = 0.0;
+		fractalSettings[NEWTON_2].setCenter(0.0, 0.0);
 		fractalSettings[NEWTON_2].scale = 0.01;
 
-		fractalSettings[NEWTON_3].centerX = 0.0;
-		fractalSettings[NEWTON_3].centerY = 0.0;
+		fractalSettings[NEWTON_3].setCenter(0.0, 0.0);
 		fractalSettings[NEWTON_3].scale = 0.02;
 
+		for (int i = 0; i < FRACTAL_COUNT; ++i)
+			defaultSettings[i] = fractalSettings[i];	// Jobs overwrite fractalSettings
+
+		for (int i = 0; i < 3; ++i) {
+			newtonPolynomials[i] = NewtonPolynomial(builtinPolynomial((FractalType)(NEWTON_1 + i)));
+			genericNewtonKernel[i] = false;
+		}
+
 		updateScales();
+		simdLevel = detectSimdLevel();
+#ifdef FRACTALS_X86_SIMD
+		hasFma = __builtin_cpu_supports("fma");
+#else
+		hasFma = false;
+#endif
+		setPixelSpacing(scaleX);
 		
 		compressionParams.push_back(cv::IMWRITE_PNG_COMPRESSION);
 		compressionParams.push_back(8);
@@ -128,6 +1295,11 @@ public:
 		compressionParams.push_back(0);
 	}
 
+	// Periodic orbits are matched to a small fraction of a pixel, so the check stays valid at any zoom
+	void setPixelSpacing(double spacing) {
+		cycleTolerance = spacing * 1e-3;
+	}
+
 	void updateScales() {
 		FractalSettings& settings = fractalSettings[currentFractal];
 		scaleX = settings.scale;
@@ -223,6 +1395,12 @@ public:
 			mvprintw(startY + FRACTAL_COUNT+8, startX-10, "m - back to menu     r - change aspect ratio");
 			mvprintw(startY + FRACTAL_COUNT+9, startX-10, "q - exit program     c - change Julia parameters");
 			mvprintw(startY + FRACTAL_COUNT+10, startX-10,"Shift+s - save to .PNG");
+			mvprintw(startY + FRACTAL_COUNT+11, startX-10,"b - rectangle subdivision on/off (faster on large flat areas)");
+			mvprintw(startY + FRACTAL_COUNT+12, startX-10,"[ ] - halve/double max iterations (needed for deep zooms)");
+			mvprintw(startY + FRACTAL_COUNT+13, startX-10,"g - smooth coloring of saved images on/off");
+			mvprintw(startY + FRACTAL_COUNT+14, startX-10,"x - next anti-aliasing pattern of saved images");
+			mvprintw(startY + FRACTAL_COUNT+15, startX-10,"h - histogram coloring on/off (spreads the palette at high max iterations)");
+			mvprintw(startY + FRACTAL_COUNT+16, startX-10,"i - automatic max iterations on/off ([ and ] set them by hand)");
 
 			refresh();
 
@@ -249,45 +1427,128 @@ public:
 		}
 	}
 
-	char getPixelChar(int iter) {
+	// With cdf the palette position of iter is cdf[iter] instead of the gamma curve (histogram coloring)
+	char getPixelChar(int iter, const double* cdf = nullptr) {
 		const char* chars = " .-:=*#%@";	// Palette
 		int paletteSize = strlen(chars);
 		
 		if (iter >= maxiter) return chars[paletteSize-1];
 
 		double t = (double)iter / maxiter;
-		double gamma = 2.2;
-		t = pow(t, 1./gamma);
+		t = cdf ? cdf[iter] : pow(t, 1./gamma);
 		
-		int index = t * (paletteSize - 1);
+		// A histogram CDF reaches 1, but the last symbol belongs to the interior
+		int index = min((int)(t * (paletteSize - 1)), paletteSize - 2);
 		return chars[index];
 	}
 
-	int mandelbrotPoint(double cx, double cy) {
-		double zx = 0., zy = 0., zx2 = 0., zy2 = 0.; // Re and Im parts and their squares
-
-		int iteration = 0;
-		while (zx2 + zy2 < 4. && iteration < maxiter) {
-			zy = 2.0*zx*zy + cy;
-			zx = zx2 - zy2 + cx;
+	// Iterates one of the quadratic variants from z until |z|^2 >= 4 or maxiter. Real is double,
+	// DoubleDouble or QuadDouble. Periodicity check (Brent): the orbit is compared with a point saved
+	// after 1, 2, 4, 8... iterations, so once the save interval exceeds the period an attracting cycle
+	// is caught and the point is interior
+	template<int Variant, class Real = double>
+	int escapeTime(Real zx, Real zy, Real cx, Real cy) {
+		Real zx2 = zx*zx, zy2 = zy*zy;	// Re and Im parts and their squares
+		Real savedX = zx, savedY = zy;
+
+		int iteration = 0, nextSave = 1;
+		while (zx2 + zy2 < bailout && iteration < maxiter) {
+			if (Variant == QUAD_ABS_IMAG || Variant == QUAD_ABS_BOTH)
+				zy = 2*fabs(zx*zy) + cy;
+			else
+				zy = (Variant == QUAD_CONJUGATE ? -2.0 : 2.0)*zx*zy + cy;
+			if (Variant == QUAD_ABS_REAL || Variant == QUAD_ABS_BOTH)
+				zx = fabs(zx2 - zy2) + cx;
+			else
+				zx = zx2 - zy2 + cx;
 			zx2 = zx*zx; zy2 = zy*zy;
 			++iteration;
+
+			if (fabs(zx - savedX) < cycleTolerance && fabs(zy - savedY) < cycleTolerance) {
+				++threadStats.cycleHits;
+				threadStats.escapeIterations += iteration;
+				return maxiter;
+			}
+			if (iteration == nextSave) {
+				savedX = zx; savedY = zy;
+				nextSave *= 2;
+			}
 		}
+		escapeNorm = toDouble(zx2 + zy2);
+		threadStats.escapeIterations += iteration;
 		return iteration;
 	}
 
+	// Same kernel built for CPUs with fused multiply-add, which the extended precision products rely on
+	template<int Variant, class Real>
+	__attribute__((target("fma"), flatten))
+	int escapeTimeFma(Real zx, Real zy, Real cx, Real cy) {
+		return escapeTime<Variant, Real>(zx, zy, cx, cy);
+	}
+
+	template<int Variant, class Real>
+	int extendedEscapeTime(Real zx, Real zy, Real cx, Real cy) {
+		return hasFma ? escapeTimeFma<Variant, Real>(zx, zy, cx, cy) : escapeTime<Variant, Real>(zx, zy, cx, cy);
+	}
+
+	// Point at offset (dx, dy) from the view center in DoubleDouble or QuadDouble
+	template<class Real>
+	int extendedPoint(double dx, double dy) {
+		Real x, y;
+		narrow(extendedCenterX, x);
+		narrow(extendedCenterY, y);
+		x = x + dx; y = y + dy;
+		FractalSettings& julia = fractalSettings[JULIA];
+
+		switch (currentFractal) {
+			case MANDELBROT:
+				if (inMainCardioidOrBulb(x.toDouble(), y.toDouble())) {
+					++threadStats.bulbHits;
+					return maxiter;
+				}
+				return extendedEscapeTime<QUAD_PLAIN, Real>(0., 0., x, y);
+			case TRICORN:		return extendedEscapeTime<QUAD_CONJUGATE, Real>(0., 0., x, y);
+			case JULIA:			return extendedEscapeTime<QUAD_PLAIN, Real>(x, y, julia.juliaCx, julia.juliaCy);
+			case BURNING_SHIP:	return extendedEscapeTime<QUAD_ABS_IMAG, Real>(0., 0., x, y);
+			case CELTIC:		return extendedEscapeTime<QUAD_ABS_REAL, Real>(0., 0., x, y);
+			case BUFFALO:		return extendedEscapeTime<QUAD_ABS_BOTH, Real>(0., 0., x, y);
+			default:			return 0;
+		}
+	}
+
+	int mandelbrotPoint(double cx, double cy) {
+		if (inMainCardioidOrBulb(cx, cy)) {
+			++threadStats.bulbHits;
+			return maxiter;
+		}
+		return escapeTime<QUAD_PLAIN>(0., 0., cx, cy);
+	}
+
 	int mandelbrotSinPoint(double cx, double cy) {
 		double zx = 0., zy = 0., zx2 = 0., zy2 = 0., new_zx;
 		const double ESCAPE_RADIUS_SQUARED = 4e2;
 
-		int iteration = 0;
+		double savedX = zx, savedY = zy;	// Periodicity check as in escapeTime
+
+		int iteration = 0, nextSave = 1;
 		while (zx2 + zy2 < ESCAPE_RADIUS_SQUARED && iteration < maxiter) {
 			new_zx = sin(zx) * cosh(zy) + cx;
 			zy = cos(zx) * sinh(zy) + cy;
 			zx = new_zx;
 			zx2 = zx*zx; zy2 = zy*zy;
 			++iteration;
+
+			if (fabs(zx - savedX) < cycleTolerance && fabs(zy - savedY) < cycleTolerance) {
+				++threadStats.cycleHits;
+				threadStats.escapeIterations += iteration;
+				return maxiter;
+			}
+			if (iteration == nextSave) {
+				savedX = zx; savedY = zy;
+				nextSave *= 2;
+			}
 		}
+		threadStats.escapeIterations += iteration;
 		return iteration;
 	}
 
@@ -297,219 +1558,612 @@ public:
 
 		double inv_cx = cx / (r * r);
 		double inv_cy = -cy / (r * r);
-		return mandelbrotPoint(inv_cx, inv_cy);
+		return mandelbrotPoint(inv_cx, inv_cy);	// Also applies the bulb test to the inverted point
 	}
 
 	int tricornPoint(double cx, double cy) {
-		double zx = 0., zy = 0., zx2 = 0., zy2 = 0.; // Re and Im parts and their squares
-
-		int iteration = 0;
-		while (zx2 + zy2 < 4. && iteration < maxiter) {
-			zy = -2.0*zx*zy + cy;
-			zx = zx2 - zy2 + cx;
-			zx2 = zx*zx; zy2 = zy*zy;
-			++iteration;
-		}
-		return iteration;
+		return escapeTime<QUAD_CONJUGATE>(0., 0., cx, cy);
 	}
 
 	int juliaPoint(double zx, double zy) {
-		double cx = fractalSettings[JULIA].juliaCx, cy = fractalSettings[JULIA].juliaCy;
-		double zx2 = zx*zx, zy2 = zy*zy;
-
-		int iteration = 0;
-		while (zx2 + zy2 < 4. && iteration < maxiter){
-			zy = 2.0*zx*zy + cy;
-			zx = zx2 - zy2 + cx;
-			zx2 = zx*zx; zy2 = zy*zy;
-			++iteration;
-		}
-		return iteration;
+		return escapeTime<QUAD_PLAIN>(zx, zy, fractalSettings[JULIA].juliaCx, fractalSettings[JULIA].juliaCy);
 	}
 
 	int burningShipPoint(double cx, double cy) {
-		double zx = 0., zy = 0., zx2 = 0., zy2 = 0.;
-		int iteration = 0;
-
-		while (zx2 + zy2 < 4.0 && iteration < maxiter) {
-			zy = 2 * fabs(zx * zy) + cy;
-			zx = zx2 - zy2 + cx;
-			zx2 = zx*zx; zy2 = zy*zy;
-			++iteration;
-		}
-		return iteration;
+		return escapeTime<QUAD_ABS_IMAG>(0., 0., cx, cy);
 	}
 
 	int celticPoint(double cx, double cy) {
-		double zx = 0., zy = 0., zx2 = 0., zy2 = 0.;
-		int iteration = 0;
-
-		while (zx2 + zy2 < 4.0 && iteration < maxiter) {
-			zy = 2*zx*zy + cy;
-			zx = fabs(zx2 - zy2) + cx;
-			zx2 = zx*zx; zy2 = zy*zy;
-			++iteration;
-		}
-		return iteration;
+		return escapeTime<QUAD_ABS_REAL>(0., 0., cx, cy);
 	}
 
 	int buffaloPoint(double cx, double cy) {
-		double zx = 0., zy = 0., zx2 = 0., zy2 = 0.;
-		int iteration = 0;
+		return escapeTime<QUAD_ABS_BOTH>(0., 0., cx, cy);
+	}
+
+	// Mandelbrot, Tricorn and Julia stay accurate past the precision of double through perturbation
+	bool supportsPerturbation(FractalType fractal) {
+		return fractal == MANDELBROT || fractal == TRICORN || fractal == JULIA;
+	}
+
+	void computeReferenceOrbit() {
+		FractalSettings& settings = fractalSettings[currentFractal];
+		FractalSettings& julia = fractalSettings[JULIA];
+		settings.updatePrecision();
+		if (reference.fractal == currentFractal && reference.maxiter == maxiter && reference.juliaCx == julia.juliaCx &&
+			reference.juliaCy == julia.juliaCy && reference.centerX == settings.preciseX && reference.centerY == settings.preciseY)
+			return;
+
+		mp_bitcnt_t bits = settings.preciseX.get_prec();
+		mpf_class zx(0, bits), zy(0, bits), zx2(0, bits), zy2(0, bits), cx(settings.preciseX, bits), cy(settings.preciseY, bits);
+		if (currentFractal == JULIA) {
+			zx = cx; zy = cy;
+			cx = julia.juliaCx; cy = julia.juliaCy;
+		}
+		double sign = currentFractal == TRICORN ? -2. : 2.;
 
-		while (zx2 + zy2 < 4.0 && iteration < maxiter) {
-			zy = 2*fabs(zx*zy) + cy;
-			zx = fabs(zx2 - zy2) + cx;
+		reference.zx.assign(1, zx.get_d());
+		reference.zy.assign(1, zy.get_d());
+		for (int i = 0; i < maxiter; ++i) {
 			zx2 = zx*zx; zy2 = zy*zy;
-			++iteration;
+			if (zx2 + zy2 >= 4) break;
+			zy = sign*zx*zy + cy;
+			zx = zx2 - zy2 + cx;
+			reference.zx.push_back(zx.get_d());
+			reference.zy.push_back(zy.get_d());
 		}
-		return iteration;
+
+		reference.fractal = currentFractal;
+		reference.maxiter = maxiter;
+		++reference.generation;
+		reference.juliaCx = julia.juliaCx; reference.juliaCy = julia.juliaCy;
+		reference.centerX = settings.preciseX; reference.centerY = settings.preciseY;
 	}
 
-	int newton1Point(double zx, double zy) {
-		double roots[6] = { // of f(z) = z^3 - 1
-			1.0, 0.0,
-			-0.5, sqrt(3.)/2,
-			-0.5, -sqrt(3.)/2
-		};
+	// Relative size of the dropped delta^2 term a BLA step may have. Small enough that the counts match plain
+	// perturbation apart from pixels whose orbits are chaotic anyway, large enough to skip most iterations
+	static constexpr double BLA_EPSILON = 1e-13;
+
+	// The approximation is holomorphic, so it works for Mandelbrot and Julia but not for the conjugated Tricorn.
+	// maxDc is the largest |delta_c| of the render: merged steps must stay valid for every pixel
+	void buildBlaTable(double maxDc) {
+		if (bla.orbitGeneration == reference.generation && bla.maxDc == maxDc)
+			return;
+		bla.orbitGeneration = reference.generation;
+		bla.maxDc = maxDc;
+		bla.levels.clear();
+
+		int last = reference.zx.size() - 1;
+		if (last < 2) return;
+		vector<BlaStep> steps(last - 1);
+		for (int m = 1; m < last; ++m) {
+			double ax = 2*reference.zx[m], ay = 2*reference.zy[m];
+			steps[m - 1] = {ax, ay, 1., 0., BLA_EPSILON * hypot(ax, ay)};
+		}
+		bla.levels.push_back(move(steps));
+
+		while (bla.levels.back().size() > 1) {
+			const vector<BlaStep>& lower = bla.levels.back();
+			vector<BlaStep> merged(lower.size() / 2);
+			for (size_t j = 0; j < merged.size(); ++j) {
+				const BlaStep& x = lower[2*j];		// Applied first
+				const BlaStep& y = lower[2*j + 1];
+				double normAx = hypot(x.ax, x.ay);
+				merged[j].ax = y.ax*x.ax - y.ay*x.ay;
+				merged[j].ay = y.ax*x.ay + y.ay*x.ax;
+				merged[j].bx = y.ax*x.bx - y.ay*x.by + y.bx;
+				merged[j].by = y.ax*x.by + y.ay*x.bx + y.by;
+				double ry = normAx > 0 ? max(0., (y.r - hypot(x.bx, x.by) * maxDc) / normAx) : 0.;
+				merged[j].r = min(x.r, ry);
+			}
+			bla.levels.push_back(move(merged));
+		}
+	}
 
-		double tolerance = 1e-6;
-		int max_newton_iter = 50;
+	// Longest BLA step at reference index m that is valid for |delta|^2 = delta2 and not longer than limit.
+	// A merged step is never valid for a larger delta than its first half, so the search goes up from level 0
+	const BlaStep* findBlaStep(int m, double delta2, int limit, int& length) {
+		if (m == 0) return nullptr;
+		const BlaStep* found = nullptr;
+		int maxLevel = m == 1 ? bla.levels.size() - 1 : min<int>(__builtin_ctz(m - 1), bla.levels.size() - 1);
+		for (int level = 0; level <= maxLevel && (1 << level) <= limit; ++level) {
+			size_t j = (m - 1) >> level;
+			if (j >= bla.levels[level].size() || delta2 >= bla.levels[level][j].r * bla.levels[level][j].r) break;
+			found = &bla.levels[level][j];
+			length = 1 << level;
+		}
+		return found;
+	}
 
-		double x2, y2, xy, fx, fy, fpx, fpy, denom, dx_root, dy_root;
-		int j;
+	// (dcx, dcy) is the offset of the point from the view center. The point's orbit is Z + delta, where Z is the
+	// reference orbit and delta' = (2Z + delta) * delta + delta_c (conjugated for Tricorn) is iterated in double.
+	// Once |Z + delta| < |delta| the reference no longer describes the orbit (a glitch), so the orbit is rebased
+	// onto the start of the reference; the same happens when the reference itself has escaped.
+	// With useBla, runs of iterations where delta stays small are replaced by a single BLA step
+	int perturbedPoint(double dcx, double dcy) {
+		const double* Zx = reference.zx.data();
+		const double* Zy = reference.zy.data();
+		int last = reference.zx.size() - 1;
+		bool julia = currentFractal == JULIA, conjugate = currentFractal == TRICORN;
+		double dx = julia ? dcx : 0., dy = julia ? dcy : 0.;	// Julia pixels differ in z0, the others in c
+		if (julia) dcx = dcy = 0.;
+
+		int m = 0, iteration = 0, length;
+		while (iteration < maxiter) {
+			const BlaStep* step = useBla ? findBlaStep(m, dx*dx + dy*dy, maxiter - iteration, length) : nullptr;
+			if (step) {
+				double nx = step->ax*dx - step->ay*dy + step->bx*dcx - step->by*dcy;
+				dy = step->ax*dy + step->ay*dx + step->bx*dcy + step->by*dcx;
+				dx = nx;
+				m += length;
+				iteration += length;
+				threadStats.blaSkipped += length;
+			} else {
+				double ax = 2*Zx[m] + dx, ay = 2*Zy[m] + dy;
+				double nx = ax*dx - ay*dy, ny = ax*dy + ay*dx;
+				dx = nx + dcx;
+				dy = (conjugate ? -ny : ny) + dcy;
+				++m;
+				++iteration;
+			}
 
-		for (int i = 0; i < max_newton_iter; ++i) {
-			x2 = zx * zx;
-			y2 = zy * zy;
-			xy = zx * zy;
+			double zx = Zx[m] + dx, zy = Zy[m] + dy;
+			double r2 = zx*zx + zy*zy;
+			if (r2 >= bailout) {
+				escapeNorm = r2;
+				break;
+			}
+			if (r2 < dx*dx + dy*dy || m == last) {
+				dx = zx - Zx[0]; dy = zy - Zy[0];
+				m = 0;
+				++threadStats.rebases;
+			}
+		}
+		threadStats.perturbedIterations += iteration;
+		threadStats.escapeIterations += iteration;
+		return iteration;
+	}
 
-			fx = zx * (x2 - 3*y2) - 1;
-			fy = zy * (3*x2 - y2);
+	static const int NEWTON_MAX_ITERATIONS = 50;
+
+	// Newton's method for polynomial (NewtonPolynomial or a StaticPolynomial) from each of the n points. out
+	// gets 1 + the index of the root a point converges to, 0 if it does not converge, and steps (if given)
+	// the iterations it took.
+	// A single orbit is one long chain of dependent multiplications, so NEWTON_LANES points are stepped in
+	// lockstep for the CPU to overlap them, and a lane takes the next point as soon as its own has finished
+	template<class Polynomial>
+	void newtonPoints(const Polynomial& polynomial, const double* px, const double* py, int n, int* out, float* steps) {
+		double zx[NEWTON_LANES], zy[NEWTON_LANES], fx[NEWTON_LANES], fy[NEWTON_LANES], fpx[NEWTON_LANES], fpy[NEWTON_LANES];
+		int point[NEWTON_LANES], iteration[NEWTON_LANES];	// point -1 marks an idle lane
+		int next = 0, active = 0;
+		for (int l = 0; l < NEWTON_LANES; ++l) {
+			zx[l] = zy[l] = 0.;
+			iteration[l] = 0;
+			point[l] = next < n ? next++ : -1;
+			if (point[l] < 0) continue;
+			zx[l] = px[point[l]];
+			zy[l] = py[point[l]];
+			++active;
+		}
 
-			fpx = 3 * (x2 - y2);
-			fpy = 6 * xy;
+		while (active > 0) {
+			polynomial.evaluate(zx, zy, fx, fy, fpx, fpy);
+
+			for (int l = 0; l < NEWTON_LANES; ++l) {
+				if (point[l] < 0) continue;
+				int root = -1;
+				double denom = fpx[l] * fpx[l] + fpy[l] * fpy[l];
+				if (denom == 0) {
+					root = 0;
+				} else {
+					double dx = (fx[l] * fpx[l] + fy[l] * fpy[l]) / denom, dy = (fy[l] * fpx[l] - fx[l] * fpy[l]) / denom;
+					zx[l] -= dx;
+					zy[l] -= dy;
+					++iteration[l];
+					// The step length filters out most iterations before any root is looked at
+					root = dx * dx + dy * dy < polynomial.arrivalStep2() ? polynomial.root(zx[l], zy[l]) : 0;
+					if (root == 0 && iteration[l] < NEWTON_MAX_ITERATIONS) root = -1;
+				}
+				if (root < 0) continue;
+
+				out[point[l]] = root;
+				if (steps) steps[point[l]] = iteration[l];
+				threadStats.newtonIterations += iteration[l];
+				iteration[l] = 0;
+				point[l] = next < n ? next++ : -1;
+				if (point[l] < 0) {
+					zx[l] = zy[l] = 0.;
+					--active;
+				} else {
+					zx[l] = px[point[l]];
+					zy[l] = py[point[l]];
+				}
+			}
+		}
+	}
 
-			denom = fpx * fpx + fpy * fpy;
-			if (denom == 0) break;
+	// The built-in polynomials run their compile-time kernels, ones given with --polynomial the generic one
+	void computeNewtonPoints(const double* px, const double* py, int n, int* out, float* steps) {
+		int index = currentFractal - NEWTON_1;
+		if (genericNewtonKernel[index]) {
+			newtonPoints(newtonPolynomials[index], px, py, n, out, steps);
+			return;
+		}
+		switch (currentFractal) {
+			case NEWTON_1: newtonPoints(StaticPolynomial<Newton1Coefficients>(), px, py, n, out, steps); break;
+			case NEWTON_2: newtonPoints(StaticPolynomial<Newton2Coefficients>(), px, py, n, out, steps); break;
+			default:	   newtonPoints(StaticPolynomial<Newton3Coefficients>(), px, py, n, out, steps); break;
+		}
+	}
 
-			zx -= (fx * fpx + fy * fpy) / denom;
-			zy -= (fy * fpx - fx * fpy) / denom;
+	// Polynomials of the Newton fractals, highest degree first
+	static vector<double> builtinPolynomial(FractalType fractal) {
+		switch (fractal) {
+			case NEWTON_1: return vector<double>(begin(Newton1Coefficients::values), end(Newton1Coefficients::values));
+			case NEWTON_2: return vector<double>(begin(Newton2Coefficients::values), end(Newton2Coefficients::values));
+			default:	   return vector<double>(begin(Newton3Coefficients::values), end(Newton3Coefficients::values));
+		}
+	}
 
-			for (j = 0; j < 3; ++j) {
-				dx_root = zx - roots[2*j];
-				dy_root = zy - roots[2*j+1];
-				if (dx_root * dx_root + dy_root * dy_root < tolerance * tolerance) {
-					return j + 1;
-				}
+	// Basin colors repeat for polynomials with more roots than there are colors
+	static int rootColor(int root) {
+		return root <= 5 ? root : 1 + (root - 1) % 5;
+	}
+
+	int computePoint(double cx, double cy) {
+		switch (currentFractal) {
+			case MANDELBROT: 	return mandelbrotPoint(cx, cy);
+			case MANDELBROT_SIN:return mandelbrotSinPoint(cx, cy);
+			case MANDELBROT_INV:return mandelbrotInvPoint(cx, cy);
+			case TRICORN:		return tricornPoint(cx, cy);
+			case JULIA:			return juliaPoint(cx, cy);
+			case BURNING_SHIP:	return burningShipPoint(cx, cy);
+			case CELTIC:		return celticPoint(cx, cy);
+			case BUFFALO:		return buffaloPoint(cx, cy);
+			case NEWTON_1: case NEWTON_2: case NEWTON_3: {
+				int root;
+				computeNewtonPoints(&cx, &cy, 1, &root, nullptr);
+				return root;
 			}
 		}
 		return 0;
 	}
 
-	int newton2Point(double zx, double zy){
-		double roots[6] = { // of f(z) = z^3 - 2z + 2
-			-1.76929235423863, 0.0,
-			0.884646177119316, 0.589742805022206,
-			0.884646177119316, -0.589742805022206			
-		};
+	// One point in the arithmetic of the current render
+	int computeAnyPoint(double x, double y) {
+		switch (arithmetic) {
+			case ARITH_PERTURBATION:	return perturbedPoint(x, y);
+			case ARITH_DOUBLE_DOUBLE:	return extendedPoint<DoubleDouble>(x, y);
+			case ARITH_QUAD_DOUBLE:		return extendedPoint<QuadDouble>(x, y);
+			default:					return computePoint(x, y);
+		}
+	}
 
-		double tolerance = 1e-6;
-		int max_newton_iter = 50;
+	static constexpr double SMOOTH_BAILOUT = 65536.;	// Squared, large enough to hide the error of the formula below
 
-		double x2, y2, xy, fx, fy, fpx, fpy, denom, dx_root, dy_root;
-		int j;
+	// Fractional count in (iteration, iteration + 1] from how far past the bailout the quadratic kernels escaped.
+	// Interior points and kernels that do not report escapeNorm keep their whole count
+	float smoothCount(int iteration) {
+		if (iteration >= maxiter || escapeNorm < bailout) return iteration;
+		return iteration + 1 - log2(log(escapeNorm) / log(bailout));
+	}
 
-		for (int i = 0; i < max_newton_iter; ++i) {
-			x2 = zx * zx;
-			y2 = zy * zy;
-			xy = zx * zy;
+	// Evaluates the points (px[i], py[i]) of the current fractal, with the vector kernels where there are some.
+	// Stores the counts of n points in out, and with smoothOut also their fractional counts (iterations for
+	// the Newton fractals), which takes the scalar kernels
+	void computePoints(const double* px, const double* py, int n, int* out, float* smoothOut = nullptr) {
+		threadStats.points += n;
+		if (currentFractal >= NEWTON_1) {
+			computeNewtonPoints(px, py, n, out, smoothOut);
+			return;
+		}
+		if (smoothOut) {
+			for (int i = 0; i < n; ++i) {
+				escapeNorm = 0.;
+				out[i] = computeAnyPoint(px[i], py[i]);
+				smoothOut[i] = smoothCount(out[i]);
+			}
+			return;
+		}
+		if (arithmetic != ARITH_DOUBLE) {
+			for (int i = 0; i < n; ++i) out[i] = computeAnyPoint(px[i], py[i]);
+			return;
+		}
 
-			fx = zx * (x2 - 3*y2 - 2) + 2;
-			fy = zy * (3*x2 - y2 - 2);
+		FractalSettings& julia = fractalSettings[JULIA];
+		EscapeParams params = {julia.juliaCx, julia.juliaCy, maxiter, cycleTolerance};
+		bool done = false;
+		switch (currentFractal) {
+			case MANDELBROT:	done = quadraticKernel<QUAD_PLAIN, false>(simdLevel, px, py, n, params, out, threadStats); break;
+			case TRICORN:		done = quadraticKernel<QUAD_CONJUGATE, false>(simdLevel, px, py, n, params, out, threadStats); break;
+			case JULIA:			done = quadraticKernel<QUAD_PLAIN, true>(simdLevel, px, py, n, params, out, threadStats); break;
+			case BURNING_SHIP:	done = quadraticKernel<QUAD_ABS_IMAG, false>(simdLevel, px, py, n, params, out, threadStats); break;
+			case CELTIC:		done = quadraticKernel<QUAD_ABS_REAL, false>(simdLevel, px, py, n, params, out, threadStats); break;
+			case BUFFALO:		done = quadraticKernel<QUAD_ABS_BOTH, false>(simdLevel, px, py, n, params, out, threadStats); break;
+			default: break;
+		}
+		if (!done)
+			for (int i = 0; i < n; ++i) out[i] = computePoint(px[i], py[i]);
+	}
 
-			fpx = 3 * (x2 - y2) - 2;
-			fpy = 6 * xy;
+	// pool.parallelFor that adds the KernelStats of all chunks to frameStats
+	void parallelCompute(int begin, int end, int grain, const function<void(int, int)>& body) {
+		pool.parallelFor(begin, end, grain, [&](int first, int last) {
+			threadStats = KernelStats();
+			body(first, last);
+			lock_guard<mutex> lock(statsMutex);
+			frameStats.add(threadStats);
+		});
+	}
 
-			denom = fpx * fpx + fpy * fpy;
-			if (denom == 0) break;
+	static constexpr int POINT_BATCH = 64;	// Points handed to computePoints at once
 
-			zx -= (fx * fpx + fy * fpy) / denom;
-			zy -= (fy * fpx - fx * fpy) / denom;
+	// Evaluates n pixels of row y starting at column xBegin
+	void computeRun(const PixelGrid& grid, int xBegin, int y, int n, int* out, float* smoothOut = nullptr) {
+		double px[POINT_BATCH], py[POINT_BATCH];
+		for (int i = 0; i < n; i += POINT_BATCH) {
+			int count = min(POINT_BATCH, n - i);
+			for (int j = 0; j < count; ++j) {
+				px[j] = grid.pointX(xBegin + i + j);
+				py[j] = grid.pointY(y);
+			}
+			computePoints(px, py, count, out + i, smoothOut ? smoothOut + i : nullptr);
+		}
+	}
 
-			for (j = 0; j < 3; ++j) {
-				dx_root = zx - roots[2*j];
-				dy_root = zy - roots[2*j+1];
-				if (dx_root * dx_root + dy_root * dy_root < tolerance * tolerance) {
-					return j + 1;
-				}
+	// Evaluates the n pixels (xs[i], ys[i]) and stores them in block, which starts at pixel (blockX, blockY)
+	void computeScattered(const PixelGrid& grid, const int* xs, const int* ys, int n, int* block, int stride, int blockX, int blockY) {
+		double px[POINT_BATCH], py[POINT_BATCH];
+		int values[POINT_BATCH];
+		for (int i = 0; i < n; i += POINT_BATCH) {
+			int count = min(POINT_BATCH, n - i);
+			for (int j = 0; j < count; ++j) {
+				px[j] = grid.pointX(xs[i + j]);
+				py[j] = grid.pointY(ys[i + j]);
 			}
+			computePoints(px, py, count, values);
+			for (int j = 0; j < count; ++j)
+				block[(ys[i + j] - blockY) * stride + xs[i + j] - blockX] = values[j];
 		}
-		return 0;
 	}
 
-	int newton3Point(double zx, double zy){
-		double roots[10] = { // of y = z^5 + z^2 - 1
-			0.808730600479392, 0.0,
-			0.464912201602898, 1.07147384027027,
-			0.464912201602898, -1.07147384027027,
-			-0.869277501842594, 0.38826940659974,
-			-0.869277501842594, -0.38826940659974
+	static const int MIN_SUBDIVIDED_SIZE = 6;	// Smaller rectangles are computed pixel by pixel
+
+	// Mariani-Silver subdivision of the rectangle [x0, x1) x [y0, y1) inside block. The border is evaluated first;
+	// if it has a single value (iteration count or Newton root) the inside is filled with it, otherwise the
+	// rectangle is split in two across its longer side. Cells holding -1 are not computed yet, so the
+	// line shared by both halves is evaluated only once
+	void subdivideRect(const PixelGrid& grid, int* block, int stride, int blockX, int blockY, int x0, int y0, int x1, int y1) {
+		vector<int> xs, ys;
+		auto cell = [&](int x, int y) -> int& { return block[(y - blockY) * stride + x - blockX]; };
+		auto addIfUnknown = [&](int x, int y) {
+			if (cell(x, y) == -1) { xs.push_back(x); ys.push_back(y); }
 		};
+		for (int x = x0; x < x1; ++x) {
+			addIfUnknown(x, y0);
+			addIfUnknown(x, y1 - 1);
+		}
+		for (int y = y0 + 1; y < y1 - 1; ++y) {
+			addIfUnknown(x0, y);
+			addIfUnknown(x1 - 1, y);
+		}
+		computeScattered(grid, xs.data(), ys.data(), xs.size(), block, stride, blockX, blockY);
+		if (x1 - x0 <= 2 || y1 - y0 <= 2) return;	// Nothing inside the border
+
+		int value = cell(x0, y0);
+		bool uniform = true;
+		for (int x = x0; x < x1 && uniform; ++x)
+			uniform = cell(x, y0) == value && cell(x, y1 - 1) == value;
+		for (int y = y0 + 1; y < y1 - 1 && uniform; ++y)
+			uniform = cell(x0, y) == value && cell(x1 - 1, y) == value;
+
+		if (uniform) {
+			for (int y = y0 + 1; y < y1 - 1; ++y)
+				fill(&cell(x0 + 1, y), &cell(x1 - 1, y), value);
+		} else if (x1 - x0 <= MIN_SUBDIVIDED_SIZE && y1 - y0 <= MIN_SUBDIVIDED_SIZE) {
+			for (int y = y0 + 1; y < y1 - 1; ++y)
+				computeRun(grid, x0 + 1, y, x1 - x0 - 2, &cell(x0 + 1, y));
+		} else if (x1 - x0 >= y1 - y0) {
+			int middle = (x0 + x1) / 2;
+			subdivideRect(grid, block, stride, blockX, blockY, x0, y0, middle + 1, y1);
+			subdivideRect(grid, block, stride, blockX, blockY, middle, y0, x1, y1);
+		} else {
+			int middle = (y0 + y1) / 2;
+			subdivideRect(grid, block, stride, blockX, blockY, x0, y0, x1, middle + 1);
+			subdivideRect(grid, block, stride, blockX, blockY, x0, middle, x1, y1);
+		}
+	}
 
-		double tolerance = 1e-6;
-		int max_newton_iter = 50;
-
-		double x2, y2, xy, x4, y4, x2y2, fx, fy, fpx, fpy, denom, dx_root, dy_root;
-		int j;
-
-		for (int i = 0; i < max_newton_iter; ++i) {
-			x2 = zx * zx;
-			y2 = zy * zy;
-			xy = zx * zy;
-			x4 = x2 * x2;
-			y4 = y2 * y2;
-			x2y2 = xy * xy;
-
-			fx = zx * (x4 - 10*x2y2 + 5*y4) + x2 - y2 - 1;
-			fy = zy * (5*x4 - 10*x2y2 + y4) + 2*xy;
+	// Computes the pixels [x0, x1) x [y0, y1) into block (pixel (x0, y0) first, rows stride apart)
+	void computeBlock(const PixelGrid& grid, int x0, int y0, int x1, int y1, int* block, int stride) {
+		if (subdivision) {
+			for (int y = y0; y < y1; ++y)
+				fill(block + (y - y0) * stride, block + (y - y0) * stride + x1 - x0, -1);
+			subdivideRect(grid, block, stride, x0, y0, x0, y0, x1, y1);
+		} else {
+			for (int y = y0; y < y1; ++y)
+				computeRun(grid, x0, y, x1 - x0, block + (y - y0) * stride);
+		}
+	}
 
-			fpx = 5*x4 - 30*x2y2 + 5*y4 + 2*zx;
-			fpy = 20 * xy * (x2 - y2) + 2*zy;
+	// Pixel spacings below which double and then double-double run out of bits
+	static constexpr double DOUBLE_SPACING = 1e-13;
+	static constexpr double DOUBLE_DOUBLE_SPACING = 1e-28;
+
+	// The quadratic family switches from double to double-double as the view is zoomed in, and further in
+	// to perturbation where it is supported and to quad-double elsewhere
+	Arithmetic chooseArithmetic(double spacing) {
+		bool quadratic = currentFractal == MANDELBROT || currentFractal == TRICORN || currentFractal == JULIA ||
+						 currentFractal == BURNING_SHIP || currentFractal == CELTIC || currentFractal == BUFFALO;
+		if (!quadratic || spacing >= DOUBLE_SPACING) return ARITH_DOUBLE;
+		if (spacing >= DOUBLE_DOUBLE_SPACING) return ARITH_DOUBLE_DOUBLE;
+		return supportsPerturbation(currentFractal) ? ARITH_PERTURBATION : ARITH_QUAD_DOUBLE;
+	}
 
-			denom = fpx * fpx + fpy * fpy;
-			if (denom == 0) break;
+	// Chooses the arithmetic for a render and returns its grid. Apart from plain double the grid
+	// yields offsets from the view center instead of absolute points
+	PixelGrid prepareGrid(double halfWidth, double halfHeight, double stepX, double stepY) {
+		FractalSettings& settings = fractalSettings[currentFractal];
+		setPixelSpacing(stepX);
+		arithmetic = chooseArithmetic(stepX);
+		switch (arithmetic) {
+			case ARITH_PERTURBATION:
+				computeReferenceOrbit();
+				useBla = currentFractal != TRICORN;
+				if (useBla)
+					buildBlaTable(currentFractal == JULIA ? 0. : hypot(halfWidth * stepX, halfHeight * stepY));
+				return {halfWidth, halfHeight, stepX, stepY, 0., 0.};
+			case ARITH_DOUBLE_DOUBLE: case ARITH_QUAD_DOUBLE:
+				settings.updatePrecision();
+				extendedCenterX = toQuadDouble(settings.preciseX);
+				extendedCenterY = toQuadDouble(settings.preciseY);
+				return {halfWidth, halfHeight, stepX, stepY, 0., 0.};
+			default:
+				return {halfWidth, halfHeight, stepX, stepY, settings.centerX, settings.centerY};
+		}
+	}
 
-			zx -= (fx * fpx + fy * fpy) / denom;
-			zy -= (fy * fpx - fx * fpy) / denom;
+	static const int TUNE_SAMPLES = 48;			// Side of the grid of points the view is probed with
+	static const int TUNE_MIN_MAXITER = 64;
+	static const int TUNE_MAX_MAXITER = 1 << 20;
+	static constexpr double TUNE_LATE_FRACTION = 5e-3;
+
+	// Automatic maxiter for an imageWidth x imageHeight view with the given pixel spacing. The view is probed on
+	// a sparse grid with maxiter doubling from TUNE_MIN_MAXITER until hardly any probe escapes in the upper half
+	// of the range, i.e. the boundary is resolved and more iterations would only turn a few more black pixels
+	// into escaping ones. Probes that already escaped keep their counts, so each round only reruns the ones that
+	// did not. While nothing escapes, maxiter only keeps doubling up to a ceiling that grows as the view shrinks:
+	// near parabolic points escape times grow like 1/sqrt(distance), so TUNE_MIN_MAXITER * sqrt(4 / span) is
+	// enough for the view's span. Views deep enough for extended arithmetic may double up to TUNE_MAX_MAXITER.
+	// A view that stays bounded up to its ceiling lies inside the set and settles on TUNE_MIN_MAXITER.
+	// The view is only probed again when it is zoomed or the size or Julia parameter change, not on pans
+	void tuneMaxiter(int imageWidth, int imageHeight, double stepX, double stepY) {
+		FractalSettings& julia = fractalSettings[JULIA];
+		TunedView view = {currentFractal, imageWidth, imageHeight, stepX, stepY, julia.juliaCx, julia.juliaCy, 0};
+		if (!autoMaxiter || currentFractal >= NEWTON_1) return;
+		if (view == tunedView) {
+			maxiter = tunedView.maxiter;	// Command line jobs set maxiter before every render
+			return;
+		}
 
-			for (j = 0; j < 5; ++j) {
-				dx_root = zx - roots[2*j];
-				dy_root = zy - roots[2*j+1];
-				if (dx_root * dx_root + dy_root * dy_root < tolerance * tolerance) {
-					return j + 1;
+		double span = max(imageWidth * stepX, imageHeight * stepY);
+		double boundedCeiling = chooseArithmetic(stepX) != ARITH_DOUBLE ? TUNE_MAX_MAXITER : TUNE_MIN_MAXITER * sqrt(max(1., 4. / span));
+		int probes = TUNE_SAMPLES * TUNE_SAMPLES;
+		vector<int> counts(probes), pending(probes);
+		for (int i = 0; i < probes; ++i) pending[i] = i;
+		for (maxiter = TUNE_MIN_MAXITER; ; maxiter *= 2) {
+			PixelGrid grid = prepareGrid(imageWidth / 2., imageHeight / 2., stepX, stepY);
+			pool.parallelFor(0, (pending.size() + POINT_BATCH - 1) / POINT_BATCH, 1, [&](int first, int last) {
+				double px[POINT_BATCH], py[POINT_BATCH];
+				int values[POINT_BATCH];
+				for (int batch = first; batch < last; ++batch) {
+					int begin = batch * POINT_BATCH, count = min<int>(POINT_BATCH, pending.size() - begin);
+					for (int j = 0; j < count; ++j) {
+						int probe = pending[begin + j];
+						px[j] = grid.pointX((probe % TUNE_SAMPLES + 0.5) * imageWidth / TUNE_SAMPLES);
+						py[j] = grid.pointY((probe / TUNE_SAMPLES + 0.5) * imageHeight / TUNE_SAMPLES);
+					}
+					computePoints(px, py, count, values);
+					for (int j = 0; j < count; ++j) counts[pending[begin + j]] = values[j];
 				}
+			});
+
+			int late = 0;
+			vector<int> bounded;
+			for (int probe : pending) {
+				if (counts[probe] >= maxiter) bounded.push_back(probe);
+				else if (counts[probe] >= maxiter / 2) ++late;
+			}
+			bool escapes = (int)bounded.size() < probes;
+			if ((escapes && late <= probes * TUNE_LATE_FRACTION) || maxiter >= TUNE_MAX_MAXITER) break;
+			if (!escapes && 2. * maxiter > boundedCeiling) {
+				maxiter = TUNE_MIN_MAXITER;
+				break;
 			}
+			pending.swap(bounded);
 		}
-		return 0;
+		view.maxiter = maxiter;
+		tunedView = view;
 	}
 
-	void renderNewtonBasins() {
+	FrameKey currentFrameKey() {
 		FractalSettings& settings = fractalSettings[currentFractal];
+		FractalSettings& julia = fractalSettings[JULIA];
+		return {currentFractal, width, height, maxiter, scaleX, scaleY, julia.juliaCx, julia.juliaCy, subdivision, settings.preciseX, settings.preciseY};
+	}
+
+	// A pan moves the view by whole cells, so the new frame is the last one shifted: new cell (x, y) = old cell
+	// (x + shiftX, y + shiftY). Returns false when nothing can be reused
+	bool frameShift(const FrameKey& key, int& shiftX, int& shiftY) {
+		if (!lastFrameValid || !key.sameExceptCenter(lastFrame)) return false;
+		double cellsX = mpf_class(key.centerX - lastFrame.centerX).get_d() / scaleX;
+		double cellsY = mpf_class(key.centerY - lastFrame.centerY).get_d() / scaleY;
+		shiftX = lround(cellsX);
+		shiftY = lround(cellsY);
+		return fabs(cellsX - shiftX) < 1e-3 && fabs(cellsY - shiftY) < 1e-3 && abs(shiftX) < width && abs(shiftY) < height;
+	}
+
+	void shiftFrame(int shiftX, int shiftY) {
+		vector<int> previous = frameBuffer;
+		int x0 = max(0, -shiftX), x1 = min(width, width - shiftX);
+		for (int y = max(0, -shiftY); y < min(height, height - shiftY); ++y)
+			copy(&previous[(y + shiftY) * width + x0 + shiftX], &previous[(y + shiftY) * width + x1 + shiftX], &frameBuffer[y * width + x0]);
+		reusedCells = (x1 - x0) * (height - abs(shiftY));
+	}
+
+	// Computes the cells [x0, x1) x [y0, y1) of frameBuffer: one row per pool task, or small blocks when subdividing
+	void computeFrameRect(const PixelGrid& grid, int x0, int y0, int x1, int y1) {
+		if (x0 >= x1 || y0 >= y1) return;
+		forEachTile(y1 - y0, x1 - x0, subdivision ? 32 : x1 - x0, subdivision ? 16 : 1, [&](int tx0, int ty0, int tx1, int ty1) {
+			computeBlock(grid, x0 + tx0, y0 + ty0, x0 + tx1, y0 + ty1, &frameBuffer[(y0 + ty0) * width + x0 + tx0], width);
+		});
+	}
+
+	// Fills frameBuffer for the whole terminal. After a pan only the strips that scrolled in are computed
+	void computeFrame() {
 		updateScales();
-		double cx, cy;
+		tuneMaxiter(width, height, scaleX, scaleY);
+		frameStats = KernelStats();
+		reusedCells = 0;
+		PixelGrid grid = prepareGrid(width/2., height/2., scaleX, scaleY);
+		FrameKey key = currentFrameKey();
+
+		int shiftX, shiftY;
+		if (frameShift(key, shiftX, shiftY)) {
+			shiftFrame(shiftX, shiftY);
+			// Rows that scrolled in take the full width, columns that scrolled in only the rows that were kept
+			int keptY0 = max(0, -shiftY), keptY1 = min(height, height - shiftY);
+			computeFrameRect(grid, 0, 0, width, keptY0);
+			computeFrameRect(grid, 0, keptY1, width, height);
+			computeFrameRect(grid, 0, keptY0, max(0, -shiftX), keptY1);
+			computeFrameRect(grid, min(width, width - shiftX), keptY0, width, keptY1);
+		} else {
+			frameBuffer.assign(width * height, 0);
+			computeFrameRect(grid, 0, 0, width, height);
+		}
+		lastFrame = key;
+		lastFrameValid = true;
+	}
+
+	// Calls body(x0, y0, x1, y1) for every tileWidth x tileHeight block of an image, spread over the pool
+	void forEachTile(int imageHeight, int imageWidth, int tileWidth, int tileHeight, const function<void(int, int, int, int)>& body) {
+		int tilesX = (imageWidth + tileWidth - 1) / tileWidth;
+		int tilesY = (imageHeight + tileHeight - 1) / tileHeight;
+
+		parallelCompute(0, tilesX * tilesY, 1, [&](int first, int last) {
+			for (int tile = first; tile < last; ++tile) {
+				int x0 = tile % tilesX * tileWidth, y0 = tile / tilesX * tileHeight;
+				body(x0, y0, min(x0 + tileWidth, imageWidth), min(y0 + tileHeight, imageHeight));
+			}
+		});
+	}
+
+	void renderNewtonBasins() {
+		computeFrame();
 		int color;
 		for (int y = 0; y < height; ++y) {
 			for (int x = 0; x < width; ++x) {
-				cx = (x - width/2.) * scaleX + settings.centerX;	// X coordinate of the point
-				cy = (y - height/2.) * scaleY + settings.centerY;	// Y coordinate of the point
-
-				switch (currentFractal) {
-					case NEWTON_1: color = newton1Point(cx, cy); break;
-					case NEWTON_2: color = newton2Point(cx, cy); break;
-					case NEWTON_3: color = newton3Point(cx, cy); break;
-				}
-
+				color = rootColor(frameBuffer[y * width + x]);
 				attron(COLOR_PAIR(color));
 				mvaddch(y, x, '@');
 				attroff(COLOR_PAIR(color));
@@ -518,40 +2172,19 @@ public:
 	}
 
 	void renderOtherFractals() {
-		FractalSettings& settings = fractalSettings[currentFractal];
-		updateScales();
-		double cx, cy;
-		int iteration;
-		char pixel;
-		for (int y = 0; y < height; ++y) {
-			for (int x = 0; x < width; ++x) {
-				cx = (x - width/2.) * scaleX + settings.centerX;	// X coordinate of the point
-				cy = (y - height/2.) * scaleY + settings.centerY;	// Y coordinate of the point
-
-				switch (currentFractal) {
-					case MANDELBROT: 	iteration = mandelbrotPoint(cx, cy); break;
-					case MANDELBROT_SIN:iteration = mandelbrotSinPoint(cx, cy); break;
-					case MANDELBROT_INV:iteration = mandelbrotInvPoint(cx, cy); break;
-					case TRICORN:		iteration = tricornPoint(cx, cy); break;
-					case JULIA:			iteration = juliaPoint(cx, cy); break;
-					case BURNING_SHIP:	iteration = burningShipPoint(cx, cy); break;
-					case CELTIC:		iteration = celticPoint(cx, cy); break;
-					case BUFFALO:		iteration = buffaloPoint(cx, cy); break;
-				}
-				
-				pixel = getPixelChar(iteration);
-				mvaddch(y, x, pixel);
-			}
-		}
-		
+		computeFrame();
+		const char* chars = histogramColoring ? histogramLut(countIterations(frameBuffer.data(), frameBuffer.size())).chars.data()
+											  : paletteLut().chars.data();
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x)
+				mvaddch(y, x, chars[frameBuffer[y * width + x]]);
 	}
 
-	RGBColor getPixelColor(int iter) {
+	RGBColor getPixelColor(int iter, const double* cdf = nullptr) {
 		if (iter >= maxiter) return RGBColor(0, 0, 0);
 	
 		double t = (double)iter / maxiter;
-		double gamma = 2.2;
-		t = pow(t, 1./gamma);
+		t = cdf ? cdf[iter] : pow(t, 1./gamma);
 
 		switch (currentPalette) {
 			case GRAYSCALE: {
@@ -580,60 +2213,449 @@ public:
 		return RGBColor(128, 128, 128);
 	}
 
-	void saveOtherFractals(int imageHeight, int imageWidth, string filename) {
+	// getPixelColor and getPixelChar evaluated once per iteration count, so the per-pixel work is a lookup
+	const PaletteLut& paletteLut() {
+		if (lut.matches(currentPalette, maxiter, gamma)) return lut;
+		lut.palette = currentPalette;
+		lut.maxiter = maxiter;
+		lut.gamma = gamma;
+		lut.colors.resize(maxiter + 1);
+		lut.chars.resize(maxiter + 1);
+		for (int iter = 0; iter <= maxiter; ++iter) {
+			RGBColor color = getPixelColor(iter);
+			lut.colors[iter] = cv::Vec3b(color.b, color.g, color.r);
+			lut.chars[iter] = getPixelChar(iter);
+		}
+		return lut;
+	}
+
+	// Number of pixels with each count 0..maxiter (larger values are counted as maxiter), collected in
+	// per-thread bins that are merged at the end
+	template<class Value>
+	vector<long long> countIterations(const Value* values, size_t n) {
+		ThreadHistogram histogram(pool.size(), maxiter);
+		int chunk = 1 << 16;
+		pool.parallelFor(0, (n + chunk - 1) / chunk, 1, [&](int first, int last) {
+			vector<long long>& bins = histogram.local();
+			for (size_t i = (size_t)first * chunk; i < min(n, (size_t)last * chunk); ++i)
+				++bins[min<long long>(values[i], maxiter)];
+		});
+		return histogram.merge();
+	}
+
+	// Palette table for histogram coloring: a count is placed at the fraction of escaped pixels with at most
+	// that count, so the whole palette is spread over the counts that actually occur
+	const PaletteLut& histogramLut(const vector<long long>& histogram) {
+		vector<double> cdf(maxiter + 1);
+		long long escaped = 0, below = 0;
+		for (int i = 0; i < maxiter; ++i) escaped += histogram[i];
+		for (int i = 0; i < maxiter; ++i) {
+			below += histogram[i];
+			cdf[i] = (double)below / max(escaped, 1LL);
+		}
+		equalizedLut.palette = currentPalette;
+		equalizedLut.maxiter = -1;	// Never matches, it depends on the histogram as well
+		equalizedLut.colors.resize(maxiter + 1);
+		equalizedLut.chars.resize(maxiter + 1);
+		for (int iter = 0; iter <= maxiter; ++iter) {
+			RGBColor color = getPixelColor(iter, cdf.data());
+			equalizedLut.colors[iter] = cv::Vec3b(color.b, color.g, color.r);
+			equalizedLut.chars[iter] = getPixelChar(iter, cdf.data());
+		}
+		return equalizedLut;
+	}
+
+	// Blends the table colors of the two whole counts around a fractional one. Interior points stay black
+	cv::Vec3b smoothColor(const cv::Vec3b* colors, float count) {
+		int index = count;
+		if (index >= maxiter) return colors[maxiter];
+		float t = count - index;
+		const cv::Vec3b& a = colors[index];
+		const cv::Vec3b& b = colors[min(index + 1, maxiter - 1)];
+		return cv::Vec3b(a[0] + t * (b[0] - a[0]), a[1] + t * (b[1] - a[1]), a[2] + t * (b[2] - a[2]));
+	}
+
+	static constexpr int TILE_SIZE = 64;	// Side of the square blocks an export is split into
+
+	// Both exports cover the same horizontal span as the terminal view (width symbols)
+	double exportPixelScale(int imageWidth) {
+		return width * fractalSettings[currentFractal].scale / imageWidth;
+	}
+
+	// Renders the pixels x0 <= x < x1, y0 <= y < y1 of an export into target, whose top left pixel is image pixel
+	// (targetX0, targetY0).
+	// color(count, fractional count) gives a sample's color. With a sample pattern the tile is computed with a one
+	// pixel border, and every pixel with a neighbour of another value is replaced by the average of its samples
+	template<class Color>
+	void renderTile(const PixelGrid& grid, int x0, int y0, int x1, int y1, int imageWidth, int imageHeight,
+					cv::Mat& target, int targetX0, int targetY0, const vector<pair<double, double>>& samples, const Color& color) {
+		const int stride = TILE_SIZE + 2;
+		int values[stride * stride];
+		float counts[stride * stride];
+		int border = samples.empty() ? 0 : 1;
+		int bx0 = max(x0 - border, 0), by0 = max(y0 - border, 0);
+		int bx1 = min(x1 + border, imageWidth), by1 = min(y1 + border, imageHeight);
+		bool newton = currentFractal >= NEWTON_1;
+		bool fractional = newton ? dumpValues != nullptr : smooth;	// Dumps keep the iterations of Newton pixels
+
+		if (fractional)	// Subdivision needs equal borders, which fractional counts never have
+			for (int y = by0; y < by1; ++y)
+				computeRun(grid, bx0, y, bx1 - bx0, values + (y - by0) * stride, counts + (y - by0) * stride);
+		else
+			computeBlock(grid, bx0, by0, bx1, by1, values, stride);
+
+		for (int y = y0; y < y1; ++y) {
+			cv::Vec3b* row = target.ptr<cv::Vec3b>(y - targetY0) - targetX0;
+			const int* rowValues = values + (y - by0) * stride - bx0;
+			const float* rowCounts = counts + (y - by0) * stride - bx0;
+			for (int x = x0; x < x1; ++x)
+				row[x] = color(rowValues[x], fractional ? rowCounts[x] : rowValues[x]);
+			if (!dumpValues) continue;
+			uint32_t* dumpRow = dumpValues + (size_t)y * imageWidth;
+			for (int x = x0; x < x1; ++x)
+				dumpRow[x] = newton && fractional ? rowValues[x] | (int)rowCounts[x] << 8 : rowValues[x];
+			if (dumpCounts)
+				memcpy(dumpCounts + (size_t)y * imageWidth + x0, rowCounts + x0, (x1 - x0) * sizeof(float));
+		}
+		if (samples.empty()) return;
+
+		int n = samples.size();
+		double px[POINT_BATCH], py[POINT_BATCH];
+		int sampleValues[POINT_BATCH];
+		float sampleCounts[POINT_BATCH];
+		for (int y = y0; y < y1; ++y) {
+			cv::Vec3b* row = target.ptr<cv::Vec3b>(y - targetY0) - targetX0;
+			for (int x = x0; x < x1; ++x) {
+				int value = values[(y - by0) * stride + x - bx0];
+				bool edge = false;
+				for (int ny = max(y - 1, by0); ny < min(y + 2, by1) && !edge; ++ny)
+					for (int nx = max(x - 1, bx0); nx < min(x + 2, bx1); ++nx)
+						if (values[(ny - by0) * stride + nx - bx0] != value) {
+							edge = true;
+							break;
+						}
+				if (!edge) continue;
+
+				int sum[3] = {0, 0, 0};
+				for (int i = 0; i < n; i += POINT_BATCH) {
+					int count = min(POINT_BATCH, n - i);
+					for (int j = 0; j < count; ++j) {
+						px[j] = grid.pointX(x + samples[i + j].first);
+						py[j] = grid.pointY(y + samples[i + j].second);
+					}
+					computePoints(px, py, count, sampleValues, fractional ? sampleCounts : nullptr);
+					for (int j = 0; j < count; ++j) {
+						cv::Vec3b c = color(sampleValues[j], fractional ? sampleCounts[j] : sampleValues[j]);
+						sum[0] += c[0]; sum[1] += c[1]; sum[2] += c[2];
+					}
+				}
+				row[x] = cv::Vec3b((sum[0] + n/2) / n, (sum[1] + n/2) / n, (sum[2] + n/2) / n);
+				++threadStats.refinedPixels;
+			}
+		}
+	}
+
+	static constexpr double STREAM_BYTES = 1 << 30;	// Larger exports are always streamed
+
+	// Renders an export with renderTile and writes it, together with its raw dump if dumpPath is set.
+	// Returns false if a file could not be written
+	template<class Color>
+	bool writeExport(const PixelGrid& grid, int imageHeight, int imageWidth, const string& filename, const Color& color) {
+		if (dumpPath.empty()) return writeImage(grid, imageHeight, imageWidth, filename, color);
+
 		FractalSettings& settings = fractalSettings[currentFractal];
-		cv::Mat image(imageHeight, imageWidth, CV_8UC3);
-		RGBColor color;
-		double cx, cy;
-		double scX = width * settings.scale, scY = width * imageHeight / imageWidth * settings.scale;
-		int iteration;
-
-		for (int y = 0; y < imageHeight; ++y) {
-			for (int x = 0; x < imageWidth; ++x) {
-				cx = (static_cast<double>(x) / imageWidth - 0.5) * scX + settings.centerX;
-				cy = (static_cast<double>(y) / imageHeight - 0.5) * scY + settings.centerY;
-
-				switch (currentFractal) {
-					case MANDELBROT:	iteration = mandelbrotPoint(cx, cy); break;
-					case MANDELBROT_SIN:iteration = mandelbrotSinPoint(cx, cy); break;
-					case MANDELBROT_INV:iteration = mandelbrotInvPoint(cx, cy); break;
-					case TRICORN:		iteration = tricornPoint(cx, cy); break;
-					case JULIA:			iteration = juliaPoint(cx, cy); break;
-					case BURNING_SHIP:	iteration = burningShipPoint(cx, cy); break;
-					case CELTIC:		iteration = celticPoint(cx, cy); break;
-					case BUFFALO:		iteration = buffaloPoint(cx, cy); break;
+		RawDumpHeader header = {{'F', 'R', 'A', 'C', 'R', 'A', 'W', '1'}, (uint32_t)imageWidth, (uint32_t)imageHeight,
+								currentFractal, maxiter, smooth && currentFractal < NEWTON_1, 0,
+								settings.centerX, settings.centerY, grid.stepX};
+		RawDump dump;
+		if (!dump.create(dumpPath, header)) return false;
+		dumpValues = dump.values();
+		dumpCounts = dump.counts();
+		bool written = writeImage(grid, imageHeight, imageWidth, filename, color);
+		dumpValues = nullptr;
+		dumpCounts = nullptr;
+		return dump.close() && written;
+	}
+
+	// Streamed exports hold one band of TILE_SIZE rows, whose tiles run in parallel before the band is
+	// compressed, instead of the whole image
+	template<class Color>
+	bool writeImage(const PixelGrid& grid, int imageHeight, int imageWidth, const string& filename, const Color& color) {
+		vector<pair<double, double>> samples = sampleOffsets(samplePattern);
+		if (!streamExport && 3. * imageWidth * imageHeight <= STREAM_BYTES) {
+			exportBuffer.create(imageHeight, imageWidth, CV_8UC3);	// Reallocates only when the size changes
+			forEachTile(imageHeight, imageWidth, TILE_SIZE, TILE_SIZE, [&](int x0, int y0, int x1, int y1) {
+				renderTile(grid, x0, y0, x1, y1, imageWidth, imageHeight, exportBuffer, 0, 0, samples, color);
+			});
+			return cv::imwrite(filename, exportBuffer, compressionParams);
+		}
+
+		PngStreamWriter writer;
+		if (!writer.open(filename, imageWidth, imageHeight)) return false;
+		exportBuffer.create(TILE_SIZE, imageWidth, CV_8UC3);
+		for (int bandY = 0; bandY < imageHeight; bandY += TILE_SIZE) {
+			int bandHeight = min(TILE_SIZE, imageHeight - bandY);
+			forEachTile(bandHeight, imageWidth, TILE_SIZE, TILE_SIZE, [&](int x0, int y0, int x1, int y1) {
+				renderTile(grid, x0, bandY + y0, x1, bandY + y1, imageWidth, imageHeight, exportBuffer, 0, bandY, samples, color);
+			});
+			for (int y = 0; y < bandHeight; ++y)
+				if (!writer.writeRow(exportBuffer.ptr<cv::Vec3b>(y))) return false;
+		}
+		return writer.finish();
+	}
+
+	// Colors raw per-pixel results (see RawDump) a band of rows at a time and writes them as a PNG.
+	// Returns false if the file could not be written
+	template<class Color>
+	bool writeColoredDump(const uint32_t* values, const float* counts, int imageHeight, int imageWidth, const string& filename,
+						  const Color& color) {
+		bool newton = currentFractal >= NEWTON_1;
+		PngStreamWriter writer;
+		if (!writer.open(filename, imageWidth, imageHeight)) return false;
+		exportBuffer.create(TILE_SIZE, imageWidth, CV_8UC3);
+		for (int bandY = 0; bandY < imageHeight; bandY += TILE_SIZE) {
+			int bandHeight = min(TILE_SIZE, imageHeight - bandY);
+			pool.parallelFor(0, bandHeight, 1, [&](int first, int last) {
+				for (int y = first; y < last; ++y) {
+					cv::Vec3b* row = exportBuffer.ptr<cv::Vec3b>(y);
+					size_t offset = (size_t)(bandY + y) * imageWidth;
+					for (int x = 0; x < imageWidth; ++x) {
+						int value = newton ? values[offset + x] & 0xff : min<uint32_t>(values[offset + x], maxiter);
+						row[x] = color(value, counts ? min(counts[offset + x], (float)maxiter) : value);
+					}
 				}
+			});
+			for (int y = 0; y < bandHeight; ++y)
+				if (!writer.writeRow(exportBuffer.ptr<cv::Vec3b>(y))) return false;
+		}
+		return writer.finish();
+	}
 
-				color = getPixelColor(iteration);
-				image.at<cv::Vec3b>(y, x) = cv::Vec3b(color.b, color.g, color.r); // BGR format!
+	// Histogram coloring needs every count before the first pixel is colored. The counts go to a buffer while
+	// the histogram is collected in per-thread bins, and are then colored from there without evaluating any
+	// kernel again. The buffer is the raw dump when one was asked for, and a temporary one next to the image
+	// for streamed exports and counts larger than STREAM_BYTES.
+	// Anti-aliasing is not applied, its samples would need the final colors during the compute pass
+	bool writeHistogramExport(const PixelGrid& grid, int imageHeight, int imageWidth, const string& filename) {
+		size_t pixels = (size_t)imageWidth * imageHeight;
+		bool mapped = !dumpPath.empty() || streamExport || (smooth ? 8. : 4.) * pixels > STREAM_BYTES;
+		string path = dumpPath.empty() ? filename + ".counts" : dumpPath;
+		RawDump dump;
+		vector<uint32_t> values;
+		vector<float> counts;
+		if (mapped) {
+			FractalSettings& settings = fractalSettings[currentFractal];
+			RawDumpHeader header = {{'F', 'R', 'A', 'C', 'R', 'A', 'W', '1'}, (uint32_t)imageWidth, (uint32_t)imageHeight,
+									currentFractal, maxiter, smooth, 0, settings.centerX, settings.centerY, grid.stepX};
+			if (!dump.create(path, header)) return false;
+			dumpValues = dump.values();
+			dumpCounts = dump.counts();
+		} else {
+			values.resize(pixels);
+			counts.resize(smooth ? pixels : 0);
+			dumpValues = values.data();
+			dumpCounts = smooth ? counts.data() : nullptr;
+		}
+		const uint32_t* resultValues = dumpValues;
+		const float* resultCounts = dumpCounts;
+
+		ThreadHistogram histogram(pool.size(), maxiter);
+		int tilesX = (imageWidth + TILE_SIZE - 1) / TILE_SIZE, tilesY = (imageHeight + TILE_SIZE - 1) / TILE_SIZE;
+		parallelCompute(0, tilesX * tilesY, 1, [&](int first, int last) {
+			vector<long long>& bins = histogram.local();
+			cv::Mat scratch(TILE_SIZE, TILE_SIZE, CV_8UC3);	// renderTile colors, the colors are not known yet
+			for (int tile = first; tile < last; ++tile) {
+				int x0 = tile % tilesX * TILE_SIZE, y0 = tile / tilesX * TILE_SIZE;
+				int x1 = min(x0 + TILE_SIZE, imageWidth), y1 = min(y0 + TILE_SIZE, imageHeight);
+				renderTile(grid, x0, y0, x1, y1, imageWidth, imageHeight, scratch, x0, y0, {}, [](int, float) { return cv::Vec3b(); });
+				for (int y = y0; y < y1; ++y)
+					for (int x = x0; x < x1; ++x)
+						++bins[min<uint32_t>(dumpValues[(size_t)y * imageWidth + x], maxiter)];
 			}
+		});
+		dumpValues = nullptr;
+		dumpCounts = nullptr;
+
+		histogramLut(histogram.merge());
+		bool written = false;
+		withSampleColor([&](const auto& color) {
+			written = writeColoredDump(resultValues, resultCounts, imageHeight, imageWidth, filename, color);
+		});
+		if (!mapped) return written;
+		bool closed = dump.close();
+		if (dumpPath.empty()) remove(path.c_str());
+		return written && closed;
+	}
+
+	// Calls body with the function that colors an export sample (count, fractional count) of the current fractal
+	template<class Body>
+	void withSampleColor(const Body& body) {
+		if (currentFractal >= NEWTON_1) {
+			static const int colors[18] = {205, 0, 126, 239, 106, 0, 242, 205, 0, 121, 195, 0, 25, 97, 174, 97, 0, 125}; // 6 colors in RGB
+			body([](int root, float) {
+				if (root < 0) return cv::Vec3b(0, 0, 0);
+				root = rootColor(root);
+				return cv::Vec3b(colors[3*root + 2], colors[3*root + 1], colors[3*root]); // Saving in BGR
+			});
+			return;
 		}
-		cv::imwrite(filename, image, compressionParams);
+		// Histogram coloring builds equalizedLut before it colors anything
+		const cv::Vec3b* colors = (histogramColoring ? equalizedLut : paletteLut()).colors.data();
+		if (smooth)
+			body([this, colors](int, float count) { return smoothColor(colors, count); });
+		else
+			body([colors](int count, float) { return colors[count]; });
 	}
 
-	void saveNewtonBasins(int imageHeight, int imageWidth, string filename) {
-		FractalSettings& settings = fractalSettings[currentFractal];
-		cv::Mat image(imageHeight, imageWidth, CV_8UC3);
-		int color, colors[18] = {205, 0, 126, 239, 106, 0, 242, 205, 0, 121, 195, 0, 25, 97, 174, 97, 0, 125}; // 6 colors in RGB
-		double cx, cy;
-
-		for (int y = 0; y < imageHeight; ++y) {
-			for (int x = 0; x < imageWidth; ++x) {
-				cx = (static_cast<double>(x) / imageWidth - 0.5) * width * settings.scale + settings.centerX;
-				cy = (static_cast<double>(y) / imageHeight - 0.5) * width * imageHeight / imageWidth * settings.scale + settings.centerY;
-
-				switch (currentFractal) {
-					case NEWTON_1: color = newton1Point(cx, cy); break;
-					case NEWTON_2: color = newton2Point(cx, cy); break;
-					case NEWTON_3: color = newton3Point(cx, cy); break;
+	// Returns false if the image could not be written, the time spent on the export goes to seconds
+	bool saveOtherFractals(int imageHeight, int imageWidth, string filename, double& seconds) {
+		auto start = chrono::steady_clock::now();
+		double pixelScale = exportPixelScale(imageWidth);
+		tuneMaxiter(imageWidth, imageHeight, pixelScale, pixelScale);
+		frameStats = KernelStats();
+		bailout = smooth ? SMOOTH_BAILOUT : 4.;
+		PixelGrid grid = prepareGrid(imageWidth/2., imageHeight/2., pixelScale, pixelScale);
+		bool written = false;
+		if (histogramColoring)
+			written = writeHistogramExport(grid, imageHeight, imageWidth, filename);
+		else
+			withSampleColor([&](const auto& color) { written = writeExport(grid, imageHeight, imageWidth, filename, color); });
+		bailout = 4.;
+		seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		return written;
+	}
+
+	// Returns false if the image could not be written, the time spent on the export goes to seconds
+	bool saveNewtonBasins(int imageHeight, int imageWidth, string filename, double& seconds) {
+		auto start = chrono::steady_clock::now();
+		double pixelScale = exportPixelScale(imageWidth);
+		frameStats = KernelStats();
+		PixelGrid grid = prepareGrid(imageWidth/2., imageHeight/2., pixelScale, pixelScale);
+		bool written = false;
+		withSampleColor([&](const auto& color) { written = writeExport(grid, imageHeight, imageWidth, filename, color); });
+		seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		return written;
+	}
+
+	static const int PYRAMID_TILE = 256;
+
+	// Writes the view as a tile pyramid dir/z/x/y.png of PYRAMID_TILE pixel tiles. The last level has
+	// imageWidth x imageHeight pixels (rounded up to whole tiles) and every level above has half the
+	// resolution, down to a single tile at level 0. Each level is rendered at its own resolution, the tiles
+	// of a level in parallel. Tiles already on disk are skipped, and new ones appear under their name only
+	// once complete, so an interrupted export resumes where it stopped. The view is kept in dir/pyramid.txt
+	// and an export into a directory that holds another view is refused, so resumed pyramids never mix views.
+	// Tiles are colored independently, so histogram coloring does not apply to pyramids.
+	// Returns the time spent in seconds, the counts of rendered, skipped and unwritable tiles go to rendered,
+	// skipped and failed. error is left empty unless some tile could not be written
+	double savePyramid(int imageHeight, int imageWidth, const string& dir, int& rendered, int& skipped, int& failed, string& error) {
+		auto start = chrono::steady_clock::now();
+		frameStats = KernelStats();
+		rendered = skipped = failed = 0;
+		error.clear();
+		int levels = 1;
+		while ((imageWidth - 1) >> (levels - 1) >= PYRAMID_TILE || (imageHeight - 1) >> (levels - 1) >= PYRAMID_TILE) ++levels;
+		double fullScale = exportPixelScale(imageWidth);
+		tuneMaxiter(imageWidth, imageHeight, fullScale, fullScale);	// One maxiter for all levels keeps their colors alike
+
+		string viewPath = dir + "/pyramid.txt", view = pyramidView(imageHeight, imageWidth, fullScale);
+		ifstream previousFile(viewPath);
+		if (previousFile) {
+			string previous{istreambuf_iterator<char>(previousFile), istreambuf_iterator<char>()};
+			if (previous != view) {
+				error = dir + " holds a pyramid of another view, see " + viewPath;
+				return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			}
+		} else if (!makeDirectory(dir) || !(ofstream(viewPath) << view)) {
+			error = "cannot write " + viewPath;
+			return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		}
+
+		bailout = smooth ? SMOOTH_BAILOUT : 4.;
+		vector<pair<double, double>> samples = sampleOffsets(samplePattern);
+		bool histogram = histogramColoring;
+		histogramColoring = false;
+
+		for (int z = 0; z < levels; ++z) {
+			int shift = levels - 1 - z;
+			int levelWidth = (imageWidth + (1 << shift) - 1) >> shift, levelHeight = (imageHeight + (1 << shift) - 1) >> shift;
+			int tilesX = (levelWidth + PYRAMID_TILE - 1) / PYRAMID_TILE, tilesY = (levelHeight + PYRAMID_TILE - 1) / PYRAMID_TILE;
+			string levelDir = dir + "/" + to_string(z);
+			bool levelMade = makeDirectory(levelDir);
+
+			vector<int> missing;	// Tiles x * tilesY + y still to render
+			for (int x = 0; x < tilesX; ++x) {
+				if (!levelMade || !makeDirectory(levelDir + "/" + to_string(x))) {
+					failed += tilesY;	// Nowhere to write the column to
+					continue;
+				}
+				for (int y = 0; y < tilesY; ++y) {
+					string name = levelDir + "/" + to_string(x) + "/" + to_string(y);
+					remove((name + ".tmp.png").c_str());	// Left behind by an interrupted export
+					struct stat fileStat;
+					if (stat((name + ".png").c_str(), &fileStat) == 0) ++skipped;
+					else missing.push_back(x * tilesY + y);
 				}
-				if (color >= 0 && color < 6)
-					image.at<cv::Vec3b>(y, x) = cv::Vec3b(colors[3*color + 2], colors[3*color + 1], colors[3*color]); // Saving in BGR
-				else
-					image.at<cv::Vec3b>(y, x) = cv::Vec3b(0, 0, 0);
 			}
+			if (missing.empty()) continue;
+
+			// Same center and span on every level, the pixels just grow by a factor of 2 per level up
+			double step = fullScale * (1 << shift);
+			PixelGrid grid = prepareGrid(imageWidth / 2. / (1 << shift), imageHeight / 2. / (1 << shift), step, step);
+			int paddedWidth = tilesX * PYRAMID_TILE, paddedHeight = tilesY * PYRAMID_TILE;
+			atomic<int> unwritten(0);
+			withSampleColor([&](const auto& color) {
+				parallelCompute(0, missing.size(), 1, [&](int first, int last) {
+					cv::Mat tile(PYRAMID_TILE, PYRAMID_TILE, CV_8UC3);
+					for (int i = first; i < last; ++i) {
+						int tileX = missing[i] / tilesY * PYRAMID_TILE, tileY = missing[i] % tilesY * PYRAMID_TILE;
+						for (int y0 = tileY; y0 < tileY + PYRAMID_TILE; y0 += TILE_SIZE)
+							for (int x0 = tileX; x0 < tileX + PYRAMID_TILE; x0 += TILE_SIZE)
+								renderTile(grid, x0, y0, x0 + TILE_SIZE, y0 + TILE_SIZE, paddedWidth, paddedHeight, tile, tileX, tileY, samples, color);
+						string name = levelDir + "/" + to_string(missing[i] / tilesY) + "/" + to_string(missing[i] % tilesY);
+						if (!cv::imwrite(name + ".tmp.png", tile, compressionParams) || rename((name + ".tmp.png").c_str(), (name + ".png").c_str()) != 0)
+							++unwritten;
+					}
+				});
+			});
+			rendered += missing.size() - unwritten;
+			failed += unwritten;
+		}
+		bailout = 4.;
+		histogramColoring = histogram;
+		if (failed > 0)
+			error = "cannot write " + to_string(failed) + " tiles of " + dir + " (" + to_string(rendered) + " written)";
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+
+	// Everything that decides the pixels of a pyramid, one "name value" line each
+	string pyramidView(int imageHeight, int imageWidth, double step) {
+		FractalSettings& settings = fractalSettings[currentFractal];
+		int digits = settings.preciseX.get_prec() * 0.30103 + 2;
+		ostringstream view;
+		view << setprecision(17);
+		view << "fractal " << fractalNamesUnderscore[currentFractal] << "\n"
+			 << "size " << imageWidth << "x" << imageHeight << "\n"
+			 << "center " << preciseString(settings.preciseX, digits) << " " << preciseString(settings.preciseY, digits) << "\n"
+			 << "step " << step << "\n"
+			 << "maxiter " << maxiter << "\n"
+			 << "palette " << paletteNames[currentPalette] << "\n"
+			 << "gamma " << gamma << "\n"
+			 << "smooth " << smooth << "\n"
+			 << "antialias " << samplePatternNames[samplePattern] << "\n";
+		if (currentFractal == JULIA)
+			view << "julia " << settings.juliaCx << " " << settings.juliaCy << "\n";
+		if (currentFractal >= NEWTON_1) {
+			view << "polynomial";
+			for (double coefficient : newtonPolynomials[currentFractal - NEWTON_1].coefficients) view << " " << coefficient;
+			view << "\n";
 		}
-		cv::imwrite(filename, image, compressionParams);
+		return view.str();
+	}
+
+	// Creates the directory unless it exists. Returns false if it cannot be created
+	static bool makeDirectory(const string& path) {
+		return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
 	}
 
 	string currentDateTime() {
@@ -647,6 +2669,18 @@ public:
 		return currentDateTimeStr;
 	}
 	
+	string defaultFilename() {
+		return "./PNG_output/" + string(fractalNamesUnderscore[currentFractal]) + "_" + currentDateTime() + ".png";
+	}
+
+	// Returns false if the image could not be written, the time spent on the export goes to seconds
+	bool saveImage(int imageHeight, int imageWidth, string filename, double& seconds) {
+		switch (currentFractal) {
+			case NEWTON_1: case NEWTON_2: case NEWTON_3: return saveNewtonBasins(imageHeight, imageWidth, filename, seconds);
+			default: return saveOtherFractals(imageHeight, imageWidth, filename, seconds);
+		}
+	}
+
 	void imageSave() {
 		ColorPalette selected = currentPalette;
 		bool selectActive = true, needSaving = true;
@@ -713,27 +2747,78 @@ public:
 		}
 
 		if (needSaving){
-			string filename = "./PNG_output/" + string(fractalNamesUnderscore[currentFractal]) + "_" + currentDateTime() + ".png";
-
-			switch (currentFractal) {
-				case NEWTON_1: case NEWTON_2: case NEWTON_3: saveNewtonBasins(imageHeight, imageWidth, filename); break;
-				default: saveOtherFractals(imageHeight, imageWidth, filename);
-			}
-			mvprintw(9 + PALETTE_COUNT, 0, "%s successfully saved. Press any button", filename.c_str());
+			string filename = defaultFilename();
+			double seconds;
+			bool saved = saveImage(imageHeight, imageWidth, filename, seconds);
+			exportBuffer.release();
+			if (saved)
+				mvprintw(9 + PALETTE_COUNT, 0, "%s successfully saved. Press any button", filename.c_str());
+			else
+				mvprintw(9 + PALETTE_COUNT, 0, "%s could not be written. Press any button", filename.c_str());
+			mvprintw(10 + PALETTE_COUNT, 0, "%d x %d pixels in %.2f s (%.2f Mpixels/s, %d threads)", imageWidth, imageHeight, seconds,
+					 (double)imageWidth * imageHeight / seconds / 1e6, pool.size());
+			if (subdivision)
+				printw(", subdivision computed %.1f%% of pixels", 100. * frameStats.points / ((double)imageWidth * imageHeight));
+			if (samplePattern != SAMPLES_OFF)
+				printw(", %s refined %lld pixels (%.1f%%)", samplePatternNames[samplePattern], frameStats.refinedPixels,
+					   100. * frameStats.refinedPixels / ((double)imageWidth * imageHeight));
+			if (currentFractal < NEWTON_1)
+				mvprintw(11 + PALETTE_COUNT, 0, "Interior shortcuts: cardioid/bulb %lld, periodic orbit %lld pixels (%.1f%%)",
+						 frameStats.bulbHits, frameStats.cycleHits, 100. * (frameStats.bulbHits + frameStats.cycleHits) / max(frameStats.points, 1LL));
 			getch();
 		}
 	}
 
+	string preciseString(const mpf_class& value, int digits) {
+		char* text;
+		gmp_asprintf(&text, "%+.*Fe", digits, value.get_mpf_t());
+		string result = text;
+		void (*freeFunction)(void*, size_t);
+		mp_get_memory_functions(nullptr, nullptr, &freeFunction);
+		freeFunction(text, result.size() + 1);
+		return result;
+	}
+
 	void showFractalInfo() {
 		FractalSettings& settings = fractalSettings[currentFractal];
 		attron(A_REVERSE);
-		mvprintw(0, 0, "Fractal: %s | Scale: %.2e | Center coordinates: (%+.7e, %+.7e)", fractalNamesSpaces[currentFractal], settings.scale, settings.centerX, settings.centerY);
+		// Enough significant digits to tell neighbouring symbols apart
+		int digits = max(7, (int)ceil(log10(max(fabs(settings.centerX), fabs(settings.centerY)) + 1.) - log10(settings.scale)) + 2);
+		mvprintw(0, 0, "Fractal: %s | Scale: %.2e | Max iterations: %d%s | Center coordinates: (%s, %s)", fractalNamesSpaces[currentFractal],
+				 settings.scale, maxiter, autoMaxiter && currentFractal < NEWTON_1 ? " (auto)" : "", preciseString(settings.preciseX, digits).c_str(), preciseString(settings.preciseY, digits).c_str());
 		mvprintw(1, 0, "Terminal dimensions: %4d x %4d | Aspect ratio: %.2f | q - quit | m - menu | r - change aspect ratio ", width, height, aspectRatio);
 		if (currentFractal == JULIA) 
 			mvprintw(2, 0, "Julia parameter: c = (%+.2f, %+.2f) | c - change Julia parameter                                      ", settings.juliaCx, settings.juliaCy);
+		move(currentFractal == JULIA ? 3 : 2, 0);
+		if (currentFractal < NEWTON_1)
+			printw("Interior shortcuts: cardioid/bulb %lld, periodic orbit %lld of %lld points (%.1f%%) ",
+				   frameStats.bulbHits, frameStats.cycleHits, frameStats.points,
+				   100. * (frameStats.bulbHits + frameStats.cycleHits) / max(frameStats.points, 1LL));
+		if (subdivision)
+			printw("| Subdivision: computed %.1f%% of cells | b - turn off ", 100. * frameStats.points / max(width * height, 1));
+		if (reusedCells > 0)
+			printw("| Reused %.1f%% of the previous frame ", 100. * reusedCells / (width * height));
+		if (smooth)
+			printw("| Smooth export coloring | g - turn off ");
+		if (histogramColoring)
+			printw("| Histogram coloring | h - turn off ");
+		if (samplePattern != SAMPLES_OFF)
+			printw("| Export anti-aliasing: %s | x - next ", samplePatternNames[samplePattern]);
+		if (arithmetic != ARITH_DOUBLE)
+			printw("| Arithmetic: %s ", arithmeticNames[arithmetic]);
+		if (arithmetic == ARITH_PERTURBATION)
+			printw("| Reference orbit %d iterations, %lld rebases ", (int)reference.zx.size() - 1, frameStats.rebases);
+		if (arithmetic == ARITH_PERTURBATION && useBla)
+			printw("| BLA skipped %.1f%% of %lld iterations ", 100. * frameStats.blaSkipped / max(frameStats.perturbedIterations, 1LL),
+				   frameStats.perturbedIterations);
 		attroff(A_REVERSE);
 	}
 	
+	// Pans move by whole terminal cells so that computeFrame can reuse the previous frame
+	double wholeCells(double cells) {
+		return max(1., round(cells));
+	}
+
 	void handleInput() {
 		int ch = getch();
 		FractalSettings& settings = fractalSettings[currentFractal];
@@ -745,16 +2830,23 @@ public:
 				if (currentFractal == JULIA) setJuliaParams();
 				break;
 			case 'S': imageSave(); break;
-			case KEY_UP: 	settings.centerY -= 0.01 * settings.scale * height * aspectRatio; break;
-			case KEY_DOWN: 	settings.centerY += 0.01 * settings.scale * height * aspectRatio; break;
-			case KEY_LEFT: 	settings.centerX -= 0.01 * settings.scale * width; break;
-			case KEY_RIGHT: settings.centerX += 0.01 * settings.scale * width; break;
-			case 'w': 	settings.centerY -= 0.1 * settings.scale * height * aspectRatio; break;
-			case 's': 	settings.centerY += 0.1 * settings.scale * height * aspectRatio; break;
-			case 'a': 	settings.centerX -= 0.1 * settings.scale * width; break;
-			case 'd': 	settings.centerX += 0.1 * settings.scale * width; break;
-			case '+': 	settings.scale *= 0.8; break;
+			case 'b':		subdivision = !subdivision; break;
+			case 'g':		smooth = !smooth; break;
+			case 'h':		histogramColoring = !histogramColoring; break;
+			case 'x':		samplePattern = (SamplePattern)((samplePattern + 1) % SAMPLE_PATTERN_COUNT); break;
+			case KEY_UP: 	settings.moveCenter(0, -wholeCells(0.01 * height) * settings.scale * aspectRatio); break;
+			case KEY_DOWN: 	settings.moveCenter(0, wholeCells(0.01 * height) * settings.scale * aspectRatio); break;
+			case KEY_LEFT: 	settings.moveCenter(-wholeCells(0.01 * width) * settings.scale, 0); break;
+			case KEY_RIGHT: settings.moveCenter(wholeCells(0.01 * width) * settings.scale, 0); break;
+			case 'w': 	settings.moveCenter(0, -wholeCells(0.1 * height) * settings.scale * aspectRatio); break;
+			case 's': 	settings.moveCenter(0, wholeCells(0.1 * height) * settings.scale * aspectRatio); break;
+			case 'a': 	settings.moveCenter(-wholeCells(0.1 * width) * settings.scale, 0); break;
+			case 'd': 	settings.moveCenter(wholeCells(0.1 * width) * settings.scale, 0); break;
+			case '+': 	settings.scale *= 0.8; settings.updatePrecision(); break;
 			case '-': 	settings.scale *= 1.2; break;
+			case ']':	maxiter *= 2; autoMaxiter = false; break;
+			case '[':	maxiter = max(maxiter / 2, 10); autoMaxiter = false; break;
+			case 'i':	autoMaxiter = !autoMaxiter; tunedView = TunedView(); break;
 			case KEY_RESIZE: getmaxyx(stdscr, height, width); break;
 		}
 	}
@@ -775,10 +2867,511 @@ public:
 		}
 		endwin();
 	}	
+
+	// Index of name in names ignoring case, -1 if it is not there
+	static int findName(const char* const* names, int count, const string& name) {
+		for (int i = 0; i < count; ++i)
+			if (strcasecmp(names[i], name.c_str()) == 0) return i;
+		return -1;
+	}
+
+	// Reads the whole of text as a number. Returns false if it is not one
+	static bool parseNumber(const string& text, double& value) {
+		char* end;
+		value = strtod(text.c_str(), &end);
+		return !text.empty() && *end == '\0' && isfinite(value);
+	}
+
+	static bool parseInteger(const string& text, int& value) {
+		char* end;
+		errno = 0;
+		long number = strtol(text.c_str(), &end, 10);
+		value = number;
+		return !text.empty() && *end == '\0' && errno == 0 && number == value;
+	}
+
+	// Reads "--option value..." arguments into job, starting from the defaults of the chosen fractal.
+	// Returns false with a message in error on a malformed argument
+	bool parseJob(const vector<string>& args, RenderJob& job, string& error) {
+		job.fractal = MANDELBROT;
+		job.palette = GRAYSCALE;
+		job.maxiter = 300;
+		job.autoMaxiter = false;
+		job.columns = 200;
+		job.imageWidth = 1920; job.imageHeight = 1080;
+		job.output.clear();
+		job.smooth = false;
+		job.samplePattern = SAMPLES_OFF;
+		job.stream = false;
+		job.pyramid.clear();
+		job.dump.clear();
+		job.histogram = false;
+		job.polynomial.clear();
+		string centerX, centerY;
+		double scale = 0., juliaCx = NAN, juliaCy = NAN;
+
+		for (size_t i = 0; i < args.size(); ++i) {
+			const string& option = args[i];
+			if (option == "--smooth" || option == "--stream" || option == "--histogram") {
+				(option == "--smooth" ? job.smooth : option == "--stream" ? job.stream : job.histogram) = true;
+				continue;
+			}
+			int valueCount = option == "--center" || option == "--julia" ? 2 : 1;
+			if (i + valueCount >= args.size()) {
+				error = "missing value for " + option;
+				return false;
+			}
+			const string& value = args[i + 1];
+			if (option == "--fractal") {
+				int index = findName(fractalNamesUnderscore, FRACTAL_COUNT, value);
+				if (index < 0) { error = "unknown fractal " + value; return false; }
+				job.fractal = (FractalType)index;
+			} else if (option == "--palette") {
+				int index = findName(paletteNames, PALETTE_COUNT, value);
+				if (index < 0) { error = "unknown palette " + value; return false; }
+				job.palette = (ColorPalette)index;
+			} else if (option == "--center") {
+				centerX = value; centerY = args[i + 2];
+			} else if (option == "--julia") {
+				if (!parseNumber(value, juliaCx) || !parseNumber(args[i + 2], juliaCy)) {
+					error = "malformed julia parameter " + value + " " + args[i + 2];
+					return false;
+				}
+			} else if (option == "--scale") {
+				if (!parseNumber(value, scale) || scale <= 0.) { error = "malformed scale " + value; return false; }
+			} else if (option == "--maxiter") {
+				job.autoMaxiter = value == "auto";
+				if (!job.autoMaxiter && !parseInteger(value, job.maxiter)) { error = "maxiter must be a number or auto, not " + value; return false; }
+			} else if (option == "--columns") {
+				if (!parseInteger(value, job.columns)) { error = "malformed columns " + value; return false; }
+			} else if (option == "--size") {
+				if (sscanf(value.c_str(), "%dx%d", &job.imageWidth, &job.imageHeight) != 2) { error = "size must be WIDTHxHEIGHT"; return false; }
+			} else if (option == "--antialias") {
+				int index = findName(samplePatternNames, SAMPLE_PATTERN_COUNT, value);
+				if (index < 0) { error = "unknown sample pattern " + value + " (off, grid2, grid3, grid4, rotated4)"; return false; }
+				job.samplePattern = (SamplePattern)index;
+			} else if (option == "--dump") {
+				job.dump = value;
+			} else if (option == "--polynomial") {
+				istringstream coefficients(value);
+				string coefficient;
+				double number;
+				while (getline(coefficients, coefficient, ',')) {
+					if (!parseNumber(coefficient, number)) { error = "malformed polynomial " + value; return false; }
+					job.polynomial.push_back(number);
+				}
+			} else if (option == "--pyramid") {
+				job.pyramid = value;
+			} else if (option == "--output") {
+				job.output = value;
+			} else {
+				error = "unknown option " + option;
+				return false;
+			}
+			i += valueCount;
+		}
+		if (scale < 0. || job.maxiter < 1 || job.columns < 1 || job.imageWidth < 1 || job.imageHeight < 1) {
+			error = "scale, maxiter, columns and size must be positive";
+			return false;
+		}
+
+		if (!job.polynomial.empty()) {
+			if (job.fractal < NEWTON_1) { error = "--polynomial needs one of the Newton fractals"; return false; }
+			int degree = NewtonPolynomial(job.polynomial).degree();
+			if (degree < 1 || degree > 255) { error = "polynomial degree must be 1 to 255"; return false; }	// Roots are stored in 8 bits
+		}
+		if (!job.pyramid.empty() && !job.dump.empty()) {
+			error = "--dump does not apply to --pyramid";
+			return false;
+		}
+		if (job.samplePattern != SAMPLES_OFF && !job.dump.empty()) {
+			error = "--dump does not apply to --antialias, refined pixels have more than one sample";
+			return false;
+		}
+
+		job.settings = defaultSettings[job.fractal];
+		if (scale > 0.) job.settings.scale = scale;
+		if (!isnan(juliaCx)) {
+			job.settings.juliaCx = juliaCx;
+			job.settings.juliaCy = juliaCy;
+		}
+		job.settings.updatePrecision();
+		if (!centerX.empty()) {
+			// Kept as text until the precision for the scale is known
+			if (job.settings.preciseX.set_str(centerX, 10) != 0 || job.settings.preciseY.set_str(centerY, 10) != 0) {
+				error = "malformed center " + centerX + " " + centerY;
+				return false;
+			}
+			job.settings.centerX = job.settings.preciseX.get_d();
+			job.settings.centerY = job.settings.preciseY.get_d();
+		}
+		return true;
+	}
+
+	// Returns false with the reason in job.error if the output (or any tile of a pyramid) could not be written.
+	// The time spent on the export goes to job.seconds
+	bool renderJob(RenderJob& job) {
+		currentFractal = job.fractal;
+		FractalSettings& settings = fractalSettings[currentFractal];
+		settings.scale = job.settings.scale;
+		settings.updatePrecision();		// Assigning an mpf_class keeps the precision of the destination
+		settings = job.settings;
+		currentPalette = job.palette;
+		maxiter = job.maxiter;
+		autoMaxiter = job.autoMaxiter;
+		smooth = job.smooth;
+		samplePattern = job.samplePattern;
+		streamExport = job.stream;
+		dumpPath = job.dump;
+		histogramColoring = job.histogram;
+		if (currentFractal >= NEWTON_1) {
+			newtonPolynomials[currentFractal - NEWTON_1] = NewtonPolynomial(job.polynomial.empty() ? builtinPolynomial(currentFractal) : job.polynomial);
+			genericNewtonKernel[currentFractal - NEWTON_1] = !job.polynomial.empty();
+		}
+		width = job.columns;
+		if (!job.pyramid.empty()) {
+			job.output = job.pyramid;
+			job.seconds = savePyramid(job.imageHeight, job.imageWidth, job.pyramid, job.tilesRendered, job.tilesSkipped, job.tilesFailed, job.error);
+			return job.error.empty();
+		}
+		if (job.output.empty()) job.output = defaultFilename();
+		bool written = saveImage(job.imageHeight, job.imageWidth, job.output, job.seconds);
+		job.error = written ? "" : "cannot write " + job.output;
+		return written;
+	}
+
+	// Renders every job of a manifest with one pool, palette table and image buffer. Each line holds the options
+	// of one job in the command line syntax, '#' starts a comment. Prints a timing line per job and a summary
+	int runJobFile(const string& path) {
+		ifstream manifest(path);
+		if (!manifest) {
+			fprintf(stderr, "cannot open %s\n", path.c_str());
+			return 1;
+		}
+		string line;
+		int lineNumber = 0, rendered = 0, failed = 0;
+		double totalSeconds = 0., totalPixels = 0.;
+		auto start = chrono::steady_clock::now();
+		printf("%-5s %-11s %9s %9s %8s  %-13s  %s\n", "line", "size", "seconds", "Mpix/s", "maxiter", "arithmetic", "output");
+		while (getline(manifest, line)) {
+			++lineNumber;
+			line = line.substr(0, line.find('#'));
+			istringstream words(line);
+			vector<string> args{istream_iterator<string>(words), istream_iterator<string>()};
+			if (args.empty()) continue;
+
+			RenderJob job;
+			string error;
+			if (!parseJob(args, job, error)) {
+				fprintf(stderr, "%s:%d: %s\n", path.c_str(), lineNumber, error.c_str());
+				++failed;
+				continue;
+			}
+			if (!renderJob(job)) {
+				fprintf(stderr, "%s:%d: %s\n", path.c_str(), lineNumber, job.error.c_str());
+				++failed;
+				continue;
+			}
+			double seconds = job.seconds, pixels = (double)job.imageWidth * job.imageHeight;
+			string size = to_string(job.imageWidth) + "x" + to_string(job.imageHeight);
+			printf("%-5d %-11s %9.3f %9.2f %8d  %-13s  %s\n", lineNumber, size.c_str(), seconds, pixels / seconds / 1e6,
+				   maxiter, arithmeticNames[arithmetic], job.output.c_str());
+			fflush(stdout);
+			totalSeconds += seconds;
+			totalPixels += pixels;
+			++rendered;
+		}
+		double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		printf("%d jobs rendered, %d failed: %.2f Mpixels in %.2f s of rendering, %.2f s wall, %d threads\n",
+			   rendered, failed, totalPixels / 1e6, totalSeconds, wall, pool.size());
+		return failed ? 1 : 0;
+	}
+
+	static const int BENCHMARK_MAXITER = 1000;
+	static constexpr double BENCHMARK_SECONDS = 0.5;	// Minimum measuring time per kernel
+
+	// Times every kernel on one thread over its default view (a 480 x 270 grid spanning 200 columns). Iterations
+	// are the ones the kernels ran, so interior shortcuts count only the iterations before them, not maxiter.
+	// The Newton polynomials are timed through their compile-time kernels and again through the generic one.
+	// Prints a table and, if jsonPath is not empty, writes the results as JSON
+	int runKernelBenchmark(const string& jsonPath) {
+		const int gridWidth = 480, gridHeight = 270;
+		const char* simdNames[] = {"none", "avx2", "avx512"};
+		vector<int> out(gridWidth);
+		width = 200;
+		maxiter = BENCHMARK_MAXITER;
+
+		FILE* json = nullptr;
+		if (!jsonPath.empty()) {
+			json = jsonPath == "-" ? stdout : fopen(jsonPath.c_str(), "w");
+			if (!json) {
+				fprintf(stderr, "cannot open %s\n", jsonPath.c_str());
+				return 1;
+			}
+			fprintf(json, "{\n  \"simd\": \"%s\",\n  \"maxiter\": %d,\n  \"grid\": [%d, %d],\n  \"kernels\": [\n",
+					simdNames[simdLevel], maxiter, gridWidth, gridHeight);
+		}
+		FILE* table = json == stdout ? stderr : stdout;
+		fprintf(table, "%-30s %12s %14s %14s\n", "kernel", "seconds", "Mpixels/s", "Giter/s");
+
+		// Every fractal, then the Newton polynomials again through the generic kernel to compare it with
+		// their compile-time ones
+		vector<pair<int, bool>> kernels;
+		for (int fractal = 0; fractal < FRACTAL_COUNT; ++fractal) kernels.push_back({fractal, false});
+		for (int fractal = NEWTON_1; fractal < FRACTAL_COUNT; ++fractal) kernels.push_back({fractal, true});
+
+		for (size_t kernel = 0; kernel < kernels.size(); ++kernel) {
+			int fractal = kernels[kernel].first;
+			bool generic = kernels[kernel].second;
+			currentFractal = (FractalType)fractal;
+			if (fractal >= NEWTON_1) genericNewtonKernel[fractal - NEWTON_1] = generic;
+			FractalSettings& settings = fractalSettings[currentFractal];
+			double pixelScale = exportPixelScale(gridWidth);
+			PixelGrid grid = prepareGrid(gridWidth/2., gridHeight/2., pixelScale, pixelScale);
+
+			long long pixels = 0;
+			int repetitions = 0;
+			threadStats = KernelStats();
+			auto start = chrono::steady_clock::now();
+			double seconds;
+			do {
+				for (int y = 0; y < gridHeight; ++y)
+					computeRun(grid, 0, y, gridWidth, out.data());
+				pixels += (long long)gridWidth * gridHeight;
+				++repetitions;
+				seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			} while (seconds < BENCHMARK_SECONDS);
+			long long iterations = fractal >= NEWTON_1 ? threadStats.newtonIterations : threadStats.escapeIterations;
+			if (fractal >= NEWTON_1) genericNewtonKernel[fractal - NEWTON_1] = false;
+
+			string name = string(fractalNames[fractal]) + (generic ? " (generic)" : "");
+			fprintf(table, "%-30s %12.3f %14.2f %14.3f\n", name.c_str(), seconds, pixels / seconds / 1e6, iterations / seconds / 1e9);
+			if (json)
+				fprintf(json, "    {\"name\": \"%s%s\", \"center\": [%.17g, %.17g], \"scale\": %.17g, \"repetitions\": %d, "
+							  "\"pixels\": %lld, \"iterations\": %lld, \"interior_shortcuts\": %lld, \"seconds\": %.6f, "
+							  "\"pixels_per_second\": %.1f, \"iterations_per_second\": %.1f}%s\n",
+						fractalNamesUnderscore[fractal], generic ? "_generic" : "", settings.centerX, settings.centerY, settings.scale, repetitions,
+						pixels, iterations, threadStats.bulbHits + threadStats.cycleHits, seconds, pixels / seconds, iterations / seconds,
+						kernel + 1 < kernels.size() ? "," : "");
+		}
+		if (json) {
+			fprintf(json, "  ]\n}\n");
+			if (json != stdout) fclose(json);
+		}
+		return 0;
+	}
+
+	// Peak resident set size in kB. On Linux the peak can be reset, elsewhere it covers the whole process
+	static long peakRssKb() {
+		ifstream status("/proc/self/status");
+		string line;
+		while (getline(status, line))
+			if (line.compare(0, 6, "VmHWM:") == 0) return atol(line.c_str() + 6);
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss;
+	}
+
+	static void resetPeakRss() {
+		ofstream clearRefs("/proc/self/clear_refs");
+		clearRefs << "5";
+	}
+
+	// Renders the default view of every fractal and a few deep zooms through the full save path at each of the
+	// sizes ("1080p", "4k", "8k") and compares wall time and peak RSS with the baseline file, flagging runs
+	// more than threshold percent worse. Writes the baseline instead when update is set or there is none yet
+	int runRenderBenchmark(const string& baselinePath, const string& sizeList, double threshold, bool update) {
+		map<string, pair<int, int>> sizeNames = {{"1080p", {1920, 1080}}, {"4k", {3840, 2160}}, {"8k", {7680, 4320}}};
+		vector<pair<string, string>> views;	// Name and job options
+		for (int fractal = 0; fractal < FRACTAL_COUNT; ++fractal)
+			views.push_back({fractalNamesUnderscore[fractal], string("--fractal ") + fractalNamesUnderscore[fractal]});
+		const char* boundary = "--center -0.719662531728479811341776026466946499181807013839737098450496 "
+							   "0.200000000000000011102230246251565404236316680908203125";	// On the maxiter 1000 boundary
+		views.push_back({"Mandelbrot_double_double", string("--fractal Mandelbrot --scale 1e-17 --maxiter 1000 ") + boundary});
+		views.push_back({"Mandelbrot_perturbation", string("--fractal Mandelbrot --scale 1e-45 --maxiter 1000 ") + boundary});
+		views.push_back({"Burning_Ship_quad_double", "--fractal Burning_Ship --scale 1e-33 --maxiter 300 "
+						 "--center -0.5 -0.843977382891676421895230873748430323142337131"});
+
+		map<string, vector<double>> baseline;	// "view size" -> seconds, peak RSS, bytes
+		ifstream baselineFile(baselinePath);
+		string view, size;
+		double seconds, rss, bytes;
+		while (baselineFile >> view >> size >> seconds >> rss >> bytes)
+			baseline[view + " " + size] = {seconds, rss, bytes};
+		update = update || baseline.empty();
+
+		string outputDir = "./benchmark_output";
+		mkdir(outputDir.c_str(), 0755);
+		ostringstream results;
+		int regressions = 0;
+		printf("%-26s %-6s %9s %9s %11s  %s\n", "view", "size", "seconds", "RSS MB", "bytes", "vs baseline");
+
+		istringstream sizes(sizeList);
+		while (getline(sizes, size, ',')) {
+			if (!sizeNames.count(size)) {
+				fprintf(stderr, "unknown size %s, expected 1080p, 4k or 8k\n", size.c_str());
+				return 1;
+			}
+			for (auto& [name, options] : views) {
+				istringstream words(options);
+				vector<string> args{istream_iterator<string>(words), istream_iterator<string>()};
+				RenderJob job;
+				string error;
+				if (!parseJob(args, job, error)) {	// From the defaults, not the view the run before left behind
+					fprintf(stderr, "%s: %s\n", name.c_str(), error.c_str());
+					return 1;
+				}
+				job.imageWidth = sizeNames[size].first;
+				job.imageHeight = sizeNames[size].second;
+				job.output = outputDir + "/" + name + "_" + size + ".png";
+
+				resetPeakRss();
+				if (!renderJob(job)) {
+					fprintf(stderr, "%s\n", job.error.c_str());
+					return 1;
+				}
+				seconds = job.seconds;
+				rss = peakRssKb() / 1024.;
+				exportBuffer.release();	// Every run allocates its own image
+				struct stat fileStat;
+				bytes = stat(job.output.c_str(), &fileStat) == 0 ? fileStat.st_size : 0;
+				remove(job.output.c_str());
+
+				string comparison = "new";
+				auto previous = baseline.find(name + " " + size);
+				if (previous != baseline.end()) {
+					double timeChange = 100. * (seconds / previous->second[0] - 1.);
+					double rssChange = 100. * (rss / previous->second[1] - 1.);
+					char text[100];
+					snprintf(text, sizeof text, "time %+.1f%%, RSS %+.1f%%", timeChange, rssChange);
+					comparison = text;
+					if (timeChange > threshold || rssChange > threshold) {
+						comparison += "  REGRESSION";
+						++regressions;
+					}
+				}
+				printf("%-26s %-6s %9.3f %9.1f %11.0f  %s\n", name.c_str(), size.c_str(), seconds, rss, bytes, comparison.c_str());
+				fflush(stdout);
+				results << name << " " << size << " " << seconds << " " << rss << " " << (long long)bytes << "\n";
+			}
+		}
+		rmdir(outputDir.c_str());
+
+		if (update) {
+			ofstream(baselinePath) << results.str();
+			printf("baseline written to %s\n", baselinePath.c_str());
+			return 0;
+		}
+		printf("%d regressions above %.0f%%\n", regressions, threshold);
+		return regressions ? 1 : 0;
+	}
+
+	// Colors a raw dump with the palette and histogram option of args (and its fractional counts if it has
+	// them) without running any kernel. Rows are colored in parallel and written a band at a time
+	int runRecolor(const string& path, const vector<string>& args) {
+		auto start = chrono::steady_clock::now();
+		RenderJob job;
+		string error;
+		RawDump dump;
+		for (size_t i = 0; i < args.size(); ++i) {	// Everything else was fixed when the dump was rendered
+			if (args[i] == "--palette" || args[i] == "--output") ++i;
+			else if (args[i] != "--histogram") {
+				fprintf(stderr, "--recolor only takes --palette, --histogram and --output, not %s\n", args[i].c_str());
+				return 1;
+			}
+		}
+		if (!parseJob(args, job, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+		if (!dump.open(path) || dump.header().fractal < 0 || dump.header().fractal >= FRACTAL_COUNT || dump.header().maxiter < 1) {
+			fprintf(stderr, "%s is not a raw dump\n", path.c_str());
+			return 1;
+		}
+		const RawDumpHeader& header = dump.header();
+		int imageWidth = header.width, imageHeight = header.height;
+		currentFractal = (FractalType)header.fractal;
+		maxiter = header.maxiter;
+		currentPalette = job.palette;
+		smooth = header.hasCounts;
+		if (job.output.empty()) job.output = defaultFilename();
+		histogramColoring = job.histogram && currentFractal < NEWTON_1;
+		if (histogramColoring)
+			histogramLut(countIterations(dump.values(), (size_t)imageWidth * imageHeight));
+
+		bool written = false;
+		withSampleColor([&](const auto& color) {
+			written = writeColoredDump(dump.values(), dump.counts(), imageHeight, imageWidth, job.output, color);
+		});
+		if (!written) {
+			fprintf(stderr, "cannot write %s\n", job.output.c_str());
+			return 1;
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+		printf("%s: %d x %d pixels recolored in %.2f s (%.2f Mpixels/s, %d threads)\n", job.output.c_str(), imageWidth, imageHeight,
+			   seconds, (double)imageWidth * imageHeight / seconds / 1e6, pool.size());
+		return 0;
+	}
+
+	// Renders the image described by the command line arguments, never touching the terminal
+	int runHeadless(int argc, char** argv) {
+		vector<string> args(argv + 1, argv + argc);
+		if (args.size() == 2 && args[0] == "--jobs") return runJobFile(args[1]);
+		if (args.size() >= 2 && args[0] == "--recolor") return runRecolor(args[1], vector<string>(args.begin() + 2, args.end()));
+		if (args.size() <= 2 && args[0] == "--benchmark-kernels") return runKernelBenchmark(args.size() == 2 ? args[1] : "");
+		if (args.size() >= 2 && args[0] == "--benchmark-render") {
+			string sizes = "1080p,4k,8k";
+			double threshold = 10.;
+			bool update = false;
+			for (size_t i = 2; i < args.size(); ++i) {
+				if (args[i] == "--update") update = true;
+				else if (args[i] == "--sizes" && i + 1 < args.size()) sizes = args[++i];
+				else if (args[i] == "--threshold" && i + 1 < args.size()) threshold = atof(args[++i].c_str());
+				else {
+					fprintf(stderr, "unknown benchmark option %s\n", args[i].c_str());
+					return 1;
+				}
+			}
+			return runRenderBenchmark(args[1], sizes, threshold, update);
+		}
+		RenderJob job;
+		string error;
+		if (!parseJob(args, job, error)) {
+			fprintf(stderr, "%s\n", error.c_str());
+			fprintf(stderr, "usage: %s [--fractal NAME] [--center X Y] [--scale S] [--julia CX CY] [--maxiter N|auto]\n"
+							"       [--palette NAME] [--size WIDTHxHEIGHT] [--columns N] [--output FILE] [--smooth]\n"
+							"       [--antialias off|grid2|grid3|grid4|rotated4] [--stream] [--pyramid DIR] [--dump FILE]\n"
+							"       [--histogram] [--polynomial A_N,...,A_0 (Newton fractals)]\n"
+							"       %s --jobs FILE    one set of the options above per line\n"
+							"       %s --recolor DUMP_FILE [--palette NAME] [--histogram] [--output FILE]\n"
+							"       %s --benchmark-kernels [JSON_FILE|-]\n"
+							"       %s --benchmark-render BASELINE [--sizes 1080p,4k,8k] [--threshold PERCENT] [--update]\n",
+							argv[0], argv[0], argv[0], argv[0], argv[0]);
+			return 1;
+		}
+		if (!renderJob(job)) {
+			fprintf(stderr, "%s\n", job.error.c_str());
+			return 1;
+		}
+		printf("%s: %d x %d pixels in %.2f s (%.2f Mpixels/s, %d threads)\n", job.output.c_str(), job.imageWidth, job.imageHeight,
+			   job.seconds, (double)job.imageWidth * job.imageHeight / job.seconds / 1e6, pool.size());
+		if (job.autoMaxiter && job.fractal < NEWTON_1)
+			printf("automatic maxiter %d\n", maxiter);
+		if (!job.pyramid.empty())
+			printf("tile pyramid: %d tiles rendered, %d already present\n", job.tilesRendered, job.tilesSkipped);
+		if (job.samplePattern != SAMPLES_OFF)
+			printf("anti-aliasing %s refined %lld pixels (%.1f%%)\n", samplePatternNames[job.samplePattern], frameStats.refinedPixels,
+				   100. * frameStats.refinedPixels / ((double)job.imageWidth * job.imageHeight));
+		return 0;
+	}
 };
 
-int main() {
+thread_local KernelStats FractalRenderer::threadStats;
+thread_local double FractalRenderer::escapeNorm;
+
+int main(int argc, char** argv) {
 	FractalRenderer renderer;
+	if (argc > 1) return renderer.runHeadless(argc, argv);	// Any argument selects the command line mode
 	renderer.initialize();
 	renderer.run();
 	return 0;